@@ -0,0 +1,281 @@
+/*
+ * MemoryPressureMonitor.hpp
+ *
+ * Copyright (c) 2025 大熊哥哥 (Bighiung)
+ *
+ * 使用许可 / License Terms:
+ *
+ * 本代码允许在个人、学术及商业项目中自由使用、修改和分发，
+ * 但必须在所有副本及衍生作品中保留本声明，且明确标注作者为：
+ *
+ *      大熊哥哥 (Bighiung)
+ *
+ * 禁止去除或修改此版权声明。
+ *
+ * This code is free to use, modify, and distribute in personal,
+ * academic, and commercial projects, provided that this notice
+ * is retained in all copies or derivative works, and the author
+ * is explicitly acknowledged as:
+ *
+ *      大熊哥哥 (Bighiung)
+ *
+ * Removal or alteration of this copyright notice is prohibited.
+ */
+
+/*
+ * 内存压力监视器 / Memory-pressure monitor
+ *
+ * 1. 压力来源可替换：Linux 上读取 cgroup v2 的 memory.current / memory.high，并通过
+ *    /proc/pressure/memory 注册 PSI 触发器，用 poll 等待事件；测试使用 FakePressureSource。
+ *    Pluggable pressure source: on Linux, cgroup v2 memory.current / memory.high plus a PSI
+ *    trigger on /proc/pressure/memory waited on with poll; tests use FakePressureSource.
+ * 2. 压力升高时调用已登记对象池的 atomic_trim()，释放没有存活对象的段并收缩空闲栈。
+ *    When pressure rises, every registered pool gets atomic_trim(), releasing segments with no
+ *    live objects and shrinking their free stacks.
+ */
+
+#pragma once
+#include "SegmentedObjectPool.hpp"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+  #include <poll.h>
+#endif
+
+enum class PressureLevel { none, moderate, critical };
+
+// ----------------------------
+// 压力来源接口 / Pressure source interface
+// ----------------------------
+class PressureSource {
+public:
+    virtual ~PressureSource() = default;
+    // 当前压力等级 / Current pressure level
+    virtual PressureLevel sample() = 0;
+    // 等待下一次可能的变化，最多 timeout；可提前返回 / Wait for a possible change, at most timeout; may return early
+    virtual void wait(std::chrono::milliseconds timeout) { std::this_thread::sleep_for(timeout); }
+    // 唤醒正在 wait 的线程 / Wake a thread blocked in wait
+    virtual void interrupt() {}
+};
+
+// ----------------------------
+// 测试用压力来源，由测试代码设置等级 / Test pressure source whose level is set by the test
+// ----------------------------
+class FakePressureSource : public PressureSource {
+public:
+    void set(PressureLevel level) {
+        { std::lock_guard<std::mutex> g(mutex_); level_ = level; changed_ = true; }
+        cv_.notify_all();
+    }
+
+    PressureLevel sample() override {
+        std::lock_guard<std::mutex> g(mutex_);
+        return level_;
+    }
+
+    void wait(std::chrono::milliseconds timeout) override {
+        std::unique_lock<std::mutex> g(mutex_);
+        cv_.wait_for(g, timeout, [this] { return changed_; });
+        changed_ = false;
+    }
+
+    void interrupt() override { set(sample()); }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    PressureLevel level_ = PressureLevel::none;
+    bool changed_ = false;
+};
+
+#if defined(__linux__)
+// ----------------------------
+// cgroup v2 + PSI 压力来源 / cgroup v2 + PSI pressure source
+// 用量达到 memory.high 的 moderate_ratio 为 moderate，达到 memory.high 为 critical；
+// memory.high 为 max 时退回 memory.max。PSI 触发器在窗口内 stall 超过阈值时把等级至少提到 moderate。
+// Usage at moderate_ratio of memory.high is moderate, at memory.high critical; memory.max is used
+// when memory.high is "max". A PSI trigger firing (stall over threshold within the window) raises
+// the level to at least moderate.
+// 非特权进程的 PSI 窗口必须是 2 s 的整数倍，所以默认窗口取 2 s；触发器注册失败时退回定时采样，
+// 原因由 psi_error() 给出。
+// Unprivileged processes may only use PSI windows that are multiples of 2 s, hence the 2 s
+// default; when the trigger cannot be registered the source falls back to timed sampling and
+// psi_error() says why.
+// ----------------------------
+class CgroupPressureSource : public PressureSource {
+public:
+    explicit CgroupPressureSource(std::string cgroup_dir = "/sys/fs/cgroup",
+                                  double moderate_ratio = 0.85,
+                                  std::chrono::microseconds psi_stall = std::chrono::milliseconds(100),
+                                  std::chrono::microseconds psi_window = std::chrono::seconds(2))
+    : dir_(std::move(cgroup_dir)), moderate_ratio_(moderate_ratio) {
+        psi_fd_ = ::open((dir_ + "/memory.pressure").c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (psi_fd_ < 0) psi_fd_ = ::open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (psi_fd_ < 0) psi_error_ = errno;
+        if (psi_fd_ >= 0) {
+            char trigger[64];
+            int n = std::snprintf(trigger, sizeof(trigger), "some %lld %lld",
+                                  static_cast<long long>(psi_stall.count()), static_cast<long long>(psi_window.count()));
+            if (::write(psi_fd_, trigger, static_cast<std::size_t>(n) + 1) < 0) {
+                psi_error_ = errno;
+                ::close(psi_fd_);
+                psi_fd_ = -1;
+            }
+        }
+        if (::pipe2(wake_, O_NONBLOCK | O_CLOEXEC) != 0) wake_[0] = wake_[1] = -1;
+    }
+
+    ~CgroupPressureSource() override {
+        if (psi_fd_ >= 0) ::close(psi_fd_);
+        if (wake_[0] >= 0) { ::close(wake_[0]); ::close(wake_[1]); }
+    }
+
+    CgroupPressureSource(const CgroupPressureSource&) = delete;
+    CgroupPressureSource& operator=(const CgroupPressureSource&) = delete;
+
+    PressureLevel sample() override {
+        PressureLevel level = PressureLevel::none;
+        const std::uint64_t current = read_value_("memory.current");
+        std::uint64_t limit = read_value_("memory.high");
+        if (limit == 0) limit = read_value_("memory.max");
+        if (current && limit) {
+            if (current >= limit) level = PressureLevel::critical;
+            else if (static_cast<double>(current) >= moderate_ratio_ * static_cast<double>(limit)) level = PressureLevel::moderate;
+        }
+        if (psi_fired_.exchange(false) && level == PressureLevel::none) level = PressureLevel::moderate;
+        return level;
+    }
+
+    // 有 PSI 触发器时 poll 等待事件，否则定时醒来 / poll for PSI events when a trigger exists, otherwise sleep
+    void wait(std::chrono::milliseconds timeout) override {
+        pollfd fds[2];
+        nfds_t n = 0;
+        if (psi_fd_ >= 0) fds[n++] = {psi_fd_, POLLPRI, 0};
+        if (wake_[0] >= 0) fds[n++] = {wake_[0], POLLIN, 0};
+        if (n == 0) { std::this_thread::sleep_for(timeout); return; }
+        if (::poll(fds, n, static_cast<int>(timeout.count())) <= 0) return;
+        if (psi_fd_ >= 0 && (fds[0].revents & POLLPRI)) psi_fired_ = true;
+        char drain[16];
+        while (wake_[0] >= 0 && ::read(wake_[0], drain, sizeof(drain)) > 0) {}
+    }
+
+    void interrupt() override {
+        if (wake_[1] >= 0) (void)!::write(wake_[1], "x", 1);
+    }
+
+    bool has_psi() const noexcept { return psi_fd_ >= 0; }
+    // 触发器注册失败时的 errno（EACCES、EINVAL、ENOENT 等），成功为 0
+    // errno from a failed trigger registration (EACCES, EINVAL, ENOENT, ...), 0 on success
+    int psi_error() const noexcept { return psi_error_; }
+
+private:
+    // 读取单值文件，"max" 或读取失败返回 0 / Read a single-value file; 0 for "max" or on failure
+    std::uint64_t read_value_(const char* name) const {
+        std::FILE* f = std::fopen((dir_ + "/" + name).c_str(), "r");
+        if (!f) return 0;
+        unsigned long long v = 0;
+        if (std::fscanf(f, "%llu", &v) != 1) v = 0;
+        std::fclose(f);
+        return v;
+    }
+
+    std::string dir_;
+    double moderate_ratio_;
+    int psi_fd_ = -1;
+    int psi_error_ = 0;
+    int wake_[2] = {-1, -1};
+    std::atomic<bool> psi_fired_{false};
+};
+#endif
+
+// ----------------------------
+// 内存压力监视器 / Memory-pressure monitor
+// 登记的对象池必须在移除前保持存活 / Registered pools must outlive their registration
+// ----------------------------
+class MemoryPressureMonitor {
+public:
+    explicit MemoryPressureMonitor(PressureSource& source) : source_(source) {}
+    MemoryPressureMonitor(const MemoryPressureMonitor&) = delete;
+    MemoryPressureMonitor& operator=(const MemoryPressureMonitor&) = delete;
+    ~MemoryPressureMonitor() { stop(); }
+
+    // 登记对象池，返回用于 remove 的编号 / Register a pool; returns an id for remove()
+    template <class T>
+    std::size_t add(SegmentedObjectPool<T>& pool) {
+        return add([&pool](PressureLevel) { return pool.atomic_trim(); });
+    }
+
+    // 登记全局登记表，压力升高时回收所有对象池 / Register the global registry, trimming every pool under pressure
+    std::size_t add(PoolRegistry& registry) {
+        return add([&registry](PressureLevel) { return registry.trim_all(); });
+    }
+
+    // 登记任意回收动作，返回释放的段数或 0 / Register any reclaim action; it returns segments released, or 0
+    std::size_t add(std::function<std::size_t(PressureLevel)> reclaim) {
+        std::lock_guard<std::mutex> g(mutex_);
+        handlers_.push_back({++next_id_, std::move(reclaim)});
+        return next_id_;
+    }
+
+    void remove(std::size_t id) {
+        std::lock_guard<std::mutex> g(mutex_);
+        std::erase_if(handlers_, [id](const Handler& h) { return h.id == id; });
+    }
+
+    // 采样一次：等级升高或保持 critical 时要求所有对象池回收，返回释放的段数
+    // Sample once: on a rise, or while critical, ask every pool to reclaim; returns segments released
+    std::size_t poll_once() {
+        const PressureLevel level = source_.sample();
+        const bool act = level > last_level_ || level == PressureLevel::critical;
+        last_level_ = level;
+        if (!act) return 0;
+        std::lock_guard<std::mutex> g(mutex_);
+        std::size_t released = 0;
+        for (auto& h : handlers_) released += h.reclaim(level);
+        ++reclaims_;
+        return released;
+    }
+
+    // 后台线程：在 source.wait 之间反复 poll_once / Background thread calling poll_once between source.wait calls
+    void start(std::chrono::milliseconds interval = std::chrono::milliseconds(1000)) {
+        if (thread_.joinable()) return;
+        running_ = true;
+        thread_ = std::thread([this, interval] {
+            while (running_) {
+                poll_once();
+                source_.wait(interval);
+            }
+        });
+    }
+
+    void stop() {
+        if (!thread_.joinable()) return;
+        running_ = false;
+        source_.interrupt();
+        thread_.join();
+    }
+
+    PressureLevel level() const noexcept { return last_level_; }
+    std::size_t reclaims() const noexcept { return reclaims_; }
+
+private:
+    struct Handler {
+        std::size_t id;
+        std::function<std::size_t(PressureLevel)> reclaim;
+    };
+
+    PressureSource& source_;
+    std::mutex mutex_;
+    std::vector<Handler> handlers_;
+    std::size_t next_id_ = 0;
+    std::atomic<PressureLevel> last_level_{PressureLevel::none};
+    std::atomic<std::size_t> reclaims_{0};
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+};
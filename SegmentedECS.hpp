@@ -0,0 +1,506 @@
+/*
+ * SegmentedECS.hpp
+ *
+ * Copyright (c) 2025 大熊哥哥 (Bighiung)
+ *
+ * 使用许可 / License Terms:
+ *
+ * 本代码允许在个人、学术及商业项目中自由使用、修改和分发，
+ * 但必须在所有副本及衍生作品中保留本声明，且明确标注作者为：
+ *
+ *      大熊哥哥 (Bighiung)
+ *
+ * 禁止去除或修改此版权声明。
+ *
+ * This code is free to use, modify, and distribute in personal,
+ * academic, and commercial projects, provided that this notice
+ * is retained in all copies or derivative works, and the author
+ * is explicitly acknowledged as:
+ *
+ *      大熊哥哥 (Bighiung)
+ *
+ * Removal or alteration of this copyright notice is prohibited.
+ */
+
+/*
+ * 基于分段页面的 ECS 存储 / Entity-component-system storage on segmented pages
+ *
+ * 1. 组件集合相同的实体属于同一原型（archetype），按块（chunk）以 SoA 列存放；块大小沿用对象池的
+ *    分段规则 detail::min_segment_pages，按页对齐，每行字节数整除块大小，不留尾部碎片。
+ *    Entities with the same component set share an archetype, stored in chunks of SoA columns; chunks
+ *    are sized with the pool's segment rule detail::min_segment_pages, page aligned, with the row size
+ *    dividing the chunk size so no tail is wasted.
+ * 2. 实体句柄为 SlotHandle（编号 + 代数），实体销毁后旧句柄失效。
+ *    Entity handles are SlotHandles (index plus generation); old handles lapse once the entity is destroyed.
+ * 3. 查询缓存匹配的原型，按块线性遍历列。删除行时用最后一行填洞，列始终稠密。
+ *    Queries cache matching archetypes and walk chunk columns linearly. Removing a row moves the last
+ *    row into the hole, so columns stay dense.
+ * 4. 遍历期间的结构变化（创建、销毁、增删组件）记入 Commands，遍历结束后批量执行。非线程安全。
+ *    Structural changes during iteration (create, destroy, add or remove components) go into Commands
+ *    and are applied in one batch afterwards. Not thread-safe.
+ */
+
+#pragma once
+#include "SegmentedObjectPool.hpp"
+
+#include <map>
+#include <tuple>
+
+using Entity = SlotHandle;
+
+namespace detail {
+// 组件的类型擦除信息 / Type-erased component information
+struct ComponentInfo {
+    std::type_index type;
+    std::size_t size;
+    std::size_t align;
+    void (*move_to)(void* dst, void* src);   // 移动构造到 dst 并析构 src / Move-construct into dst, then destroy src
+    void (*destroy)(void* p);
+};
+
+template <class C>
+const ComponentInfo& component_info() {
+    static_assert(std::is_move_constructible_v<C>, "components are relocated by move construction");
+    static const ComponentInfo info{
+        std::type_index(typeid(C)), sizeof(C), alignof(C),
+        [](void* dst, void* src) { C* s = static_cast<C*>(src); ::new (dst) C(std::move(*s)); s->~C(); },
+        [](void* p) { static_cast<C*>(p)->~C(); }};
+    return info;
+}
+} // namespace detail
+
+class EcsWorld {
+    struct Archetype;
+
+public:
+    // 块的最少页数，实际页数还要满足行大小整除 / Minimum pages per chunk; rounded up so the row size divides it
+    explicit EcsWorld(std::size_t chunk_min_pages = 4)
+    : page_size_(detail::os_page_size()), chunk_min_pages_(chunk_min_pages) {}
+
+    EcsWorld(const EcsWorld&) = delete;
+    EcsWorld& operator=(const EcsWorld&) = delete;
+
+    ~EcsWorld() {
+        for (auto& a : archetypes_) {
+            while (a->size) pop_row_(*a);
+            for (auto& c : a->chunks) free_chunk_(*a, c.data);
+            if (a->spare) free_chunk_(*a, a->spare);
+        }
+    }
+
+    // =============================================================
+    // 实体 / Entities
+    // =============================================================
+
+    template <class... Cs>
+    Entity create(Cs&&... comps) {
+        assert(iterating_ == 0 && "structural change during iteration; use Commands");
+        const Entity e = new_entity_();
+        place_components_(e, std::forward<Cs>(comps)...);
+        return e;
+    }
+
+    void destroy(Entity e) {
+        assert(iterating_ == 0 && "structural change during iteration; use Commands");
+        if (!alive(e)) return;
+        Record& r = records_[e.index];
+        remove_row_(*r.arch, r.row);
+        r.arch = nullptr;
+        ++r.gen;
+        free_ids_.push_back(e.index);
+        --live_;
+    }
+
+    bool alive(Entity e) const noexcept {
+        return e.index < records_.size() && records_[e.index].gen == e.gen && records_[e.index].arch;
+    }
+
+    std::size_t size() const noexcept { return live_; }
+
+    // 组件指针，实体不存在或没有该组件时返回 nullptr；结构变化后失效
+    // Component pointer, nullptr if the entity is gone or lacks it; invalidated by structural changes
+    template <class C>
+    C* get(Entity e) noexcept {
+        if (!alive(e)) return nullptr;
+        const Record& r = records_[e.index];
+        const std::size_t k = r.arch->column_of(typeid(C));
+        return k == npos ? nullptr : static_cast<C*>(column_(*r.arch, r.row, k));
+    }
+
+    template <class C>
+    bool has(Entity e) const noexcept {
+        return alive(e) && records_[e.index].arch->column_of(typeid(C)) != npos;
+    }
+
+    // 增加组件：实体迁移到新原型；已有该组件时原地赋值 / Add a component, moving the entity to a new archetype; assigns if present
+    template <class C>
+    C& add(Entity e, C&& value) {
+        using D = std::decay_t<C>;
+        assert(iterating_ == 0 && "structural change during iteration; use Commands");
+        assert(alive(e));
+        if (D* p = get<D>(e)) return *p = std::forward<C>(value);
+        Record& r = records_[e.index];
+        std::vector<std::type_index> sig = r.arch->signature;
+        sig.insert(std::upper_bound(sig.begin(), sig.end(), std::type_index(typeid(D))), typeid(D));
+        Archetype& dst = *archetype_(std::move(sig), &detail::component_info<D>());
+        move_(e, dst);
+        return *::new (column_(dst, r.row, dst.column_of(typeid(D)))) D(std::forward<C>(value));
+    }
+
+    template <class C>
+    void remove(Entity e) {
+        assert(iterating_ == 0 && "structural change during iteration; use Commands");
+        if (!has<C>(e)) return;
+        std::vector<std::type_index> sig = records_[e.index].arch->signature;
+        std::erase(sig, std::type_index(typeid(C)));
+        move_(e, *archetype_(std::move(sig)));
+    }
+
+    // =============================================================
+    // 查询 / Queries
+    // =============================================================
+    // 缓存包含 Cs... 的原型，新原型在下次遍历时补入 / Caches archetypes containing Cs...; new ones are picked up on the next pass
+
+    template <class... Cs>
+    class Query {
+    public:
+        // fn(Cs&...) 或 fn(Entity, Cs&...) / fn(Cs&...) or fn(Entity, Cs&...)
+        template <class Fn>
+        void each(Fn&& fn) {
+            each_chunk([&](std::size_t n, const Entity* ids, Cs*... cols) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    if constexpr (std::is_invocable_v<Fn&, Entity, Cs&...>) fn(ids[i], cols[i]...);
+                    else fn(cols[i]...);
+                }
+            });
+        }
+
+        // 每块调用一次 fn(n, entities, Cs* columns...)，便于向量化 / Once per chunk with whole columns, for vectorized loops
+        template <class Fn>
+        void each_chunk(Fn&& fn) {
+            refresh_();
+            ++world_.iterating_;
+            struct Done { EcsWorld& w; ~Done() { --w.iterating_; } } done{world_};
+            for (auto& m : matched_) {
+                Archetype& a = *m.arch;
+                for (const Chunk& c : a.chunks) {
+                    [&]<std::size_t... I>(std::index_sequence<I...>) {
+                        fn(c.count, reinterpret_cast<const Entity*>(c.data + a.entity_offset),
+                           reinterpret_cast<Cs*>(c.data + a.offsets[m.cols[I]])...);
+                    }(std::index_sequence_for<Cs...>{});
+                }
+            }
+        }
+
+        std::size_t count() {
+            refresh_();
+            std::size_t n = 0;
+            for (auto& m : matched_) n += m.arch->size;
+            return n;
+        }
+
+    private:
+        friend class EcsWorld;
+        explicit Query(EcsWorld& world) : world_(world) {}
+
+        struct Match {
+            Archetype* arch;
+            std::array<std::size_t, sizeof...(Cs)> cols;
+        };
+
+        void refresh_() {
+            for (; seen_ < world_.archetypes_.size(); ++seen_) {
+                Archetype* a = world_.archetypes_[seen_].get();
+                Match m{a, {a->column_of(typeid(Cs))...}};
+                if (std::find(m.cols.begin(), m.cols.end(), npos) == m.cols.end()) matched_.push_back(m);
+            }
+        }
+
+        EcsWorld& world_;
+        std::vector<Match> matched_;
+        std::size_t seen_ = 0;
+    };
+
+    template <class... Cs>
+    Query<Cs...> query() { return Query<Cs...>(*this); }
+
+    template <class... Cs, class Fn>
+    void each(Fn&& fn) { query<Cs...>().each(std::forward<Fn>(fn)); }
+
+    // =============================================================
+    // 批量结构变化 / Batched structural changes
+    // =============================================================
+    // 遍历中记录，apply 时按记录顺序执行；create 立即返回句柄，apply 之前 alive() 为 false
+    // Recorded during iteration and applied in order by apply(); create returns its handle at once,
+    // though alive() stays false until apply()
+
+    class Commands {
+    public:
+        explicit Commands(EcsWorld& world) : world_(world) {}
+
+        template <class... Cs>
+        Entity create(Cs&&... comps) {
+            const Entity e = world_.new_entity_();
+            push_([e, t = std::make_tuple(std::decay_t<Cs>(std::forward<Cs>(comps))...)](EcsWorld& w) mutable {
+                std::apply([&](auto&... c) { w.place_components_(e, std::move(c)...); }, t);
+            });
+            return e;
+        }
+
+        void destroy(Entity e) { destroys_.push_back(e); }
+
+        template <class C>
+        void add(Entity e, C&& value) {
+            push_([e, v = std::decay_t<C>(std::forward<C>(value))](EcsWorld& w) mutable {
+                if (w.alive(e)) w.add(e, std::move(v));
+            });
+        }
+
+        template <class C>
+        void remove(Entity e) {
+            push_([e](EcsWorld& w) { w.remove<C>(e); });
+        }
+
+        // 先执行创建与增删组件，最后统一销毁 / Creations and component changes first, destructions last
+        void apply() {
+            assert(world_.iterating_ == 0 && "Commands::apply during iteration");
+            for (auto& op : ops_) op->run(world_);
+            for (Entity e : destroys_) world_.destroy(e);
+            ops_.clear();
+            destroys_.clear();
+        }
+
+        ~Commands() { apply(); }
+
+    private:
+        // 组件只要求可移动，不能用 std::function / Components need only be movable, which rules out std::function
+        struct Op {
+            virtual ~Op() = default;
+            virtual void run(EcsWorld& w) = 0;
+        };
+
+        template <class Fn>
+        struct FnOp final : Op {
+            Fn fn;
+            explicit FnOp(Fn&& f) : fn(std::move(f)) {}
+            void run(EcsWorld& w) override { fn(w); }
+        };
+
+        template <class Fn>
+        void push_(Fn&& fn) { ops_.push_back(std::make_unique<FnOp<std::decay_t<Fn>>>(std::forward<Fn>(fn))); }
+
+        EcsWorld& world_;
+        std::vector<std::unique_ptr<Op>> ops_;
+        std::vector<Entity> destroys_;
+    };
+
+    // 原型与块的统计 / Archetype and chunk statistics
+    std::size_t archetype_count() const noexcept { return archetypes_.size(); }
+
+    std::size_t chunk_count() const noexcept {
+        std::size_t n = 0;
+        for (auto& a : archetypes_) n += a->chunks.size();
+        return n;
+    }
+
+    // 含 Cs... 的原型每块的行数 / Rows per chunk of the archetype holding exactly Cs...
+    template <class... Cs>
+    std::size_t chunk_capacity() {
+        return archetype_(signature_<Cs...>())->capacity;
+    }
+
+private:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    struct Chunk {
+        std::byte* data = nullptr;
+        std::size_t count = 0;
+    };
+
+    // 块内布局：各列按对齐从大到小排列，最后是实体列；列宽都是自身对齐的倍数，列首自然对齐
+    // Chunk layout: columns by decreasing alignment, then the entity column; every column width is a
+    // multiple of its own alignment, so each column start is naturally aligned
+    struct Archetype {
+        std::vector<std::type_index> signature;              // 按 type_index 排序 / Sorted by type_index
+        std::vector<const detail::ComponentInfo*> comps;     // 与 signature 同序 / Same order as signature
+        std::vector<std::size_t> offsets;                    // 各列在块内的偏移 / Column offsets within a chunk
+        std::size_t entity_offset = 0;
+        std::size_t capacity = 0;                            // 每块行数 / Rows per chunk
+        std::size_t chunk_bytes = 0;
+        std::size_t align = 0;
+        std::vector<Chunk> chunks;                           // 除最后一块外都是满的 / All full except the last
+        std::byte* spare = nullptr;                          // 保留一个空块避免抖动 / One empty chunk kept to avoid churn
+        std::size_t size = 0;
+
+        std::size_t column_of(std::type_index t) const noexcept {
+            for (std::size_t k = 0; k < signature.size(); ++k)
+                if (signature[k] == t) return k;
+            return npos;
+        }
+    };
+
+    struct Record {
+        std::uint32_t gen = 0;
+        Archetype* arch = nullptr;
+        std::size_t row = 0;
+    };
+
+    template <class... Cs>
+    static std::vector<std::type_index> signature_() {
+        std::vector<std::type_index> sig{std::type_index(typeid(Cs))...};
+        std::sort(sig.begin(), sig.end());
+        assert(std::adjacent_find(sig.begin(), sig.end()) == sig.end() && "duplicate component type");
+        ((component_infos_()[typeid(Cs)] = &detail::component_info<Cs>()), ...);
+        return sig;
+    }
+
+    static std::map<std::type_index, const detail::ComponentInfo*>& component_infos_() {
+        static std::map<std::type_index, const detail::ComponentInfo*> infos;
+        return infos;
+    }
+
+    // 查找或创建原型 / Find or create an archetype
+    Archetype* archetype_(std::vector<std::type_index> sig, const detail::ComponentInfo* added = nullptr) {
+        if (auto it = by_signature_.find(sig); it != by_signature_.end()) return it->second;
+        if (added) component_infos_()[added->type] = added;
+        auto a = std::make_unique<Archetype>();
+        a->signature = std::move(sig);
+        std::size_t row = sizeof(Entity), align = alignof(Entity);
+        for (auto t : a->signature) {
+            const detail::ComponentInfo* info = component_infos_().at(t);
+            a->comps.push_back(info);
+            row += info->size;
+            align = std::max(align, info->align);
+        }
+        // 与对象池分段相同：页数取页大小与行大小的最小公倍数；过大时退回最少页数并容忍尾部余量
+        // Same as pool segments: pages from the lcm of page and row size; when that grows too large,
+        // fall back to the minimum and accept a tail
+        std::size_t pages = detail::min_segment_pages(page_size_, row, chunk_min_pages_);
+        if (pages > 16 * std::max<std::size_t>(chunk_min_pages_, 1))
+            pages = std::max(chunk_min_pages_, (row + page_size_ - 1) / page_size_);
+        a->chunk_bytes = pages * page_size_;
+        a->capacity = a->chunk_bytes / row;
+        a->align = std::max(align, page_size_);
+
+        std::vector<std::size_t> order(a->comps.size());
+        for (std::size_t k = 0; k < order.size(); ++k) order[k] = k;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t x, std::size_t y) { return a->comps[x]->align > a->comps[y]->align; });
+        a->offsets.resize(order.size());
+        std::size_t off = 0;
+        for (std::size_t k : order) {
+            a->offsets[k] = off;
+            off += a->capacity * a->comps[k]->size;
+        }
+        a->entity_offset = detail::round_up(off, alignof(Entity));
+
+        Archetype* raw = a.get();
+        archetypes_.push_back(std::move(a));
+        by_signature_.emplace(raw->signature, raw);
+        return raw;
+    }
+
+    Entity new_entity_() {
+        std::uint32_t index;
+        if (!free_ids_.empty()) {
+            index = free_ids_.back();
+            free_ids_.pop_back();
+        } else {
+            assert(records_.size() < SlotHandle::invalid && "entity index space exhausted");
+            index = static_cast<std::uint32_t>(records_.size());
+            records_.emplace_back();
+        }
+        return Entity{index, records_[index].gen};
+    }
+
+    template <class... Cs>
+    void place_components_(Entity e, Cs&&... comps) {
+        Archetype& a = *archetype_(signature_<std::decay_t<Cs>...>());
+        place_(e, a);
+        (::new (column_(a, records_[e.index].row, a.column_of(typeid(std::decay_t<Cs>))))
+            std::decay_t<Cs>(std::forward<Cs>(comps)), ...);
+    }
+
+    // 在原型末尾追加一行，组件列未构造 / Append a row to an archetype; component columns are left unconstructed
+    void place_(Entity e, Archetype& a) {
+        if (a.chunks.empty() || a.chunks.back().count == a.capacity) {
+            std::byte* data = a.spare ? std::exchange(a.spare, nullptr)
+                                      : static_cast<std::byte*>(::operator new(a.chunk_bytes, std::align_val_t(a.align)));
+            a.chunks.push_back({data, 0});
+        }
+        Chunk& c = a.chunks.back();
+        ::new (c.data + a.entity_offset + c.count * sizeof(Entity)) Entity(e);
+        ++c.count;
+        Record& r = records_[e.index];
+        r.arch = &a;
+        r.row = a.size++;
+        ++live_;
+    }
+
+    void* column_(Archetype& a, std::size_t row, std::size_t k) noexcept {
+        const Chunk& c = a.chunks[row / a.capacity];
+        return c.data + a.offsets[k] + (row % a.capacity) * a.comps[k]->size;
+    }
+
+    Entity& entity_at_(Archetype& a, std::size_t row) noexcept {
+        const Chunk& c = a.chunks[row / a.capacity];
+        return *reinterpret_cast<Entity*>(c.data + a.entity_offset + (row % a.capacity) * sizeof(Entity));
+    }
+
+    // 把实体迁移到 dst：共有组件移动过去，其余析构 / Move an entity to dst: shared components move, the rest are destroyed
+    void move_(Entity e, Archetype& dst) {
+        Record& r = records_[e.index];
+        Archetype& src = *r.arch;
+        const std::size_t src_row = r.row;
+        place_(e, dst);
+        --live_;
+        for (std::size_t k = 0; k < src.comps.size(); ++k) {
+            void* from = column_(src, src_row, k);
+            const std::size_t d = dst.column_of(src.signature[k]);
+            if (d != npos) src.comps[k]->move_to(column_(dst, r.row, d), from);
+            else src.comps[k]->destroy(from);
+        }
+        fill_hole_(src, src_row);
+    }
+
+    void remove_row_(Archetype& a, std::size_t row) {
+        for (std::size_t k = 0; k < a.comps.size(); ++k) a.comps[k]->destroy(column_(a, row, k));
+        fill_hole_(a, row);
+    }
+
+    // 行已析构：最后一行移入空洞，保持列稠密 / The row is already destroyed: move the last row in to keep columns dense
+    void fill_hole_(Archetype& a, std::size_t row) {
+        const std::size_t last = a.size - 1;
+        if (row != last) {
+            for (std::size_t k = 0; k < a.comps.size(); ++k) a.comps[k]->move_to(column_(a, row, k), column_(a, last, k));
+            const Entity moved = entity_at_(a, last);
+            entity_at_(a, row) = moved;
+            records_[moved.index].row = row;
+        }
+        --a.size;
+        if (--a.chunks.back().count == 0) {
+            if (a.spare) free_chunk_(a, a.spare);
+            a.spare = a.chunks.back().data;
+            a.chunks.pop_back();
+        }
+    }
+
+    void pop_row_(Archetype& a) {
+        const Entity e = entity_at_(a, a.size - 1);
+        remove_row_(a, a.size - 1);
+        records_[e.index].arch = nullptr;
+    }
+
+    static void free_chunk_(Archetype& a, std::byte* data) noexcept {
+        ::operator delete(data, std::align_val_t(a.align));
+    }
+
+    std::size_t page_size_;
+    std::size_t chunk_min_pages_;
+    std::vector<std::unique_ptr<Archetype>> archetypes_;   // 只增不减，查询按下标补入 / Append-only; queries catch up by index
+    std::map<std::vector<std::type_index>, Archetype*> by_signature_;
+    std::vector<Record> records_;
+    std::vector<std::uint32_t> free_ids_;
+    std::size_t live_ = 0;
+    int iterating_ = 0;
+};
@@ -0,0 +1,355 @@
+/*
+ * SegmentedMalloc.cpp
+ *
+ * Copyright (c) 2025 大熊哥哥 (Bighiung)
+ *
+ * 使用许可 / License Terms:
+ *
+ * 本代码允许在个人、学术及商业项目中自由使用、修改和分发，
+ * 但必须在所有副本及衍生作品中保留本声明，且明确标注作者为：
+ *
+ *      大熊哥哥 (Bighiung)
+ *
+ * 禁止去除或修改此版权声明。
+ *
+ * This code is free to use, modify, and distribute in personal,
+ * academic, and commercial projects, provided that this notice
+ * is retained in all copies or derivative works, and the author
+ * is explicitly acknowledged as:
+ *
+ *      大熊哥哥 (Bighiung)
+ *
+ * Removal or alteration of this copyright notice is prohibited.
+ */
+
+/*
+ * SegmentedMalloc 小对象 malloc 替换 / Small-object malloc replacement (Linux, glibc)
+ *
+ * 1. 不超过 kMaxSmall 的请求按尺寸分级，每一级使用与 SegmentedObjectPool 相同的段大小规则
+ *    （页大小与槽位大小的最小公倍数）切分页面 / Requests up to kMaxSmall are split into size
+ *    classes; each class carves pages with the same segment sizing rule as SegmentedObjectPool
+ *    (lcm of page size and slot size).
+ * 2. 所有段来自一次预留的连续地址区间，按页记录尺寸级别，free 时 O(1) 找到所属级别 / All segments
+ *    come from one reserved address range with a per-page class map, so free() finds the class in O(1).
+ * 3. 每线程每级一个空闲链缓存，批量与全局链交换 / Per-thread, per-class free-list caches exchange
+ *    blocks with the central list in batches.
+ * 4. 更大的请求、更严格的对齐以及不属于本区间的指针转交 glibc / Larger requests, stricter
+ *    alignments and foreign pointers are forwarded to glibc.
+ *
+ * SegmentedObjectPool<T> 本身的段表和空闲栈使用 std::vector/std::stack，会递归调用 malloc，
+ * 所以这里只复用它的段大小计算，空闲块用块内指针串成链表（槽位至少 sizeof(void*)）。
+ * SegmentedObjectPool<T> keeps its segment table and free stack in std containers that would
+ * recurse into malloc, so only its segment sizing is reused here; free blocks are chained
+ * through their first word (slots are at least sizeof(void*)).
+ *
+ * 编译 / Build:
+ *      g++ -O2 -std=c++20 -shared -fPIC SegmentedMalloc.cpp -o libsegmalloc.so -ldl -lpthread
+ * 使用 / Use:
+ *      LD_PRELOAD=./libsegmalloc.so ./your_program
+ */
+
+#include "SegmentedObjectPool.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+extern "C" {
+void* __libc_malloc(std::size_t);
+void  __libc_free(void*);
+void* __libc_calloc(std::size_t, std::size_t);
+void* __libc_realloc(void*, std::size_t);
+void* __libc_memalign(std::size_t, std::size_t);
+}
+
+namespace segmalloc {
+
+constexpr std::size_t kMaxSmall      = 1024;                  // 最大小对象 / Largest small request
+constexpr std::size_t kRegionBytes   = std::size_t(32) << 30; // 预留地址空间 / Reserved address space
+constexpr std::size_t kSegmentMinKiB = 64;                    // 段的最小尺寸 / Minimum segment size
+constexpr std::uint32_t kBatch       = 32;                    // 线程缓存批量 / Thread cache batch
+
+constexpr std::size_t kClassSizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256, 320, 384, 448, 512,
+    640, 768, 896, 1024,
+};
+constexpr std::size_t kClasses = sizeof(kClassSizes) / sizeof(kClassSizes[0]);
+
+// 尺寸到级别的查表，按 16 字节取整 / Size-to-class lookup in 16-byte steps
+constexpr auto make_class_table() {
+    struct Table { std::uint8_t v[kMaxSmall / 16 + 1]; } t{};
+    std::size_t c = 0;
+    for (std::size_t i = 0; i <= kMaxSmall / 16; ++i) {
+        while (kClassSizes[c] < i * 16) ++c;
+        t.v[i] = static_cast<std::uint8_t>(c);
+    }
+    return t;
+}
+constexpr auto kClassOf = make_class_table();
+
+inline std::size_t class_of(std::size_t n) noexcept { return kClassOf.v[(n + 15) >> 4]; }
+
+struct FreeBlock { FreeBlock* next; };
+
+// 全局的每级状态 / Central per-class state
+struct Central {
+    std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    FreeBlock* free = nullptr;
+    std::byte* bump = nullptr;          // 当前段的下一个未切分块 / Next uncarved block in the current segment
+    std::byte* end = nullptr;
+    std::size_t segment_bytes = 0;
+
+    void acquire() noexcept {
+        while (lock.test_and_set(std::memory_order_acquire)) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+    void release() noexcept { lock.clear(std::memory_order_release); }
+};
+
+struct ThreadCache {
+    FreeBlock* head[kClasses];
+    std::uint32_t count[kClasses];
+    bool registered;
+};
+
+std::byte* g_base = nullptr;
+std::uint8_t* g_page_class = nullptr;   // 0 = 未使用，否则为级别 + 1 / 0 = unused, otherwise class + 1
+std::size_t g_page_shift = 12;
+std::atomic<std::size_t> g_top{0};      // 已切出的区间字节数 / Bytes of the region handed out so far
+std::atomic<int> g_state{0};            // 0 未初始化，1 初始化中，2 就绪，3 失败 / 0 none, 1 initializing, 2 ready, 3 failed
+Central g_central[kClasses];
+pthread_key_t g_key;
+
+__attribute__((tls_model("initial-exec"))) thread_local ThreadCache t_cache;
+
+void flush_thread_cache(void*) noexcept;
+
+void init_slow() noexcept {
+    int expected = 0;
+    if (!g_state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel)) {
+        while (g_state.load(std::memory_order_acquire) == 1) {}
+        return;
+    }
+    const std::size_t page = detail::os_page_size();
+    std::size_t shift = 0;
+    while ((std::size_t(1) << shift) < page) ++shift;
+    const std::size_t pages = kRegionBytes >> shift;
+
+    void* region = ::mmap(nullptr, kRegionBytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    void* map = ::mmap(nullptr, pages, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED || map == MAP_FAILED) {
+        g_state.store(3, std::memory_order_release);
+        return;
+    }
+    g_base = static_cast<std::byte*>(region);
+    g_page_class = static_cast<std::uint8_t*>(map);
+    g_page_shift = shift;
+
+    for (std::size_t c = 0; c < kClasses; ++c) {
+        std::size_t min_pages = (kSegmentMinKiB * 1024) / page;
+        g_central[c].segment_bytes = detail::min_segment_pages(page, kClassSizes[c], min_pages) * page;
+    }
+    pthread_key_create(&g_key, flush_thread_cache);
+    pthread_atfork(
+        [] { for (auto& c : g_central) c.acquire(); },
+        [] { for (auto& c : g_central) c.release(); },
+        [] { for (auto& c : g_central) c.release(); });
+    g_state.store(2, std::memory_order_release);
+}
+
+inline bool ready() noexcept {
+    int s = g_state.load(std::memory_order_acquire);
+    if (s == 2) return true;
+    if (s == 3) return false;
+    init_slow();
+    return g_state.load(std::memory_order_acquire) == 2;
+}
+
+// 指针所属级别，不属于本区间时返回 kClasses / Class of a pointer, kClasses if it is not ours
+inline std::size_t owner_class(const void* p) noexcept {
+    auto* b = static_cast<const std::byte*>(p);
+    if (!g_base || b < g_base || b >= g_base + kRegionBytes) return kClasses;
+    auto off = static_cast<std::size_t>(b - g_base);
+    std::uint8_t c = g_page_class[off >> g_page_shift];
+    return c ? c - 1 : kClasses;
+}
+
+// 从区间切出一个新段 / Carve a new segment out of the region
+bool grow(Central& c, std::size_t cls) noexcept {
+    std::size_t off = g_top.fetch_add(c.segment_bytes, std::memory_order_relaxed);
+    if (off + c.segment_bytes > kRegionBytes) return false;
+    std::memset(g_page_class + (off >> g_page_shift), static_cast<int>(cls + 1),
+                c.segment_bytes >> g_page_shift);
+    c.bump = g_base + off;
+    c.end = c.bump + c.segment_bytes;
+    return true;
+}
+
+// 给线程缓存补充一批 / Refill a thread cache with one batch
+FreeBlock* refill(std::size_t cls) noexcept {
+    Central& c = g_central[cls];
+    const std::size_t size = kClassSizes[cls];
+    FreeBlock* head = nullptr;
+    std::uint32_t n = 0;
+    c.acquire();
+    while (n < kBatch && c.free) {
+        FreeBlock* b = c.free;
+        c.free = b->next;
+        b->next = head;
+        head = b;
+        ++n;
+    }
+    while (n < kBatch) {
+        if (c.bump == c.end && !grow(c, cls)) break;
+        auto* b = reinterpret_cast<FreeBlock*>(c.bump);
+        c.bump += size;
+        b->next = head;
+        head = b;
+        ++n;
+    }
+    c.release();
+    t_cache.count[cls] += n;
+    return head;
+}
+
+// 把一批块还给全局链 / Return one batch to the central list
+void drain(std::size_t cls, std::uint32_t n) noexcept {
+    FreeBlock* first = t_cache.head[cls];
+    FreeBlock* last = first;
+    for (std::uint32_t i = 1; i < n; ++i) last = last->next;
+    t_cache.head[cls] = last->next;
+    t_cache.count[cls] -= n;
+    Central& c = g_central[cls];
+    c.acquire();
+    last->next = c.free;
+    c.free = first;
+    c.release();
+}
+
+void flush_thread_cache(void*) noexcept {
+    for (std::size_t cls = 0; cls < kClasses; ++cls)
+        if (t_cache.count[cls]) drain(cls, t_cache.count[cls]);
+}
+
+inline void* small_alloc(std::size_t cls) noexcept {
+    FreeBlock* b = t_cache.head[cls];
+    if (!b) {
+        if (!t_cache.registered) {
+            t_cache.registered = true;
+            pthread_setspecific(g_key, &t_cache);
+        }
+        b = refill(cls);
+        if (!b) return nullptr;
+    }
+    t_cache.head[cls] = b->next;
+    --t_cache.count[cls];
+    return b;
+}
+
+inline void small_free(void* p, std::size_t cls) noexcept {
+    auto* b = static_cast<FreeBlock*>(p);
+    b->next = t_cache.head[cls];
+    t_cache.head[cls] = b;
+    if (++t_cache.count[cls] > 2 * kBatch) drain(cls, kBatch);
+}
+
+using usable_size_fn = std::size_t (*)(void*);
+
+std::size_t foreign_usable_size(void* p) noexcept {
+    static usable_size_fn next = reinterpret_cast<usable_size_fn>(::dlsym(RTLD_NEXT, "malloc_usable_size"));
+    return next ? next(p) : 0;
+}
+
+// 找到满足对齐的最小级别 / Smallest class whose blocks satisfy the alignment
+inline std::size_t aligned_class(std::size_t n, std::size_t align) noexcept {
+    for (std::size_t cls = class_of(n); cls < kClasses; ++cls)
+        if (detail::low_bit(kClassSizes[cls]) >= align) return cls;
+    return kClasses;
+}
+
+} // namespace segmalloc
+
+using namespace segmalloc;
+
+extern "C" {
+
+void* malloc(std::size_t n) {
+    if (n <= kMaxSmall && ready()) {
+        if (void* p = small_alloc(class_of(n))) return p;
+    }
+    return __libc_malloc(n);
+}
+
+void free(void* p) {
+    if (!p) return;
+    std::size_t cls = owner_class(p);
+    if (cls < kClasses) small_free(p, cls);
+    else __libc_free(p);
+}
+
+void* calloc(std::size_t count, std::size_t size) {
+    std::size_t n;
+    if (__builtin_mul_overflow(count, size, &n)) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    if (n <= kMaxSmall && ready()) {
+        if (void* p = small_alloc(class_of(n))) return std::memset(p, 0, n);
+    }
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, std::size_t n) {
+    if (!p) return malloc(n);
+    std::size_t cls = owner_class(p);
+    if (cls == kClasses) return __libc_realloc(p, n);
+    if (n == 0) {
+        small_free(p, cls);
+        return nullptr;
+    }
+    const std::size_t old = kClassSizes[cls];
+    if (n <= old && n >= old / 2) return p;   // 原地缩小 / Shrink in place
+    void* q = malloc(n);
+    if (!q) return nullptr;
+    std::memcpy(q, p, std::min(old, n));
+    small_free(p, cls);
+    return q;
+}
+
+int posix_memalign(void** out, std::size_t align, std::size_t n) {
+    if (align < sizeof(void*) || (align & (align - 1)) != 0) return EINVAL;
+    void* p = nullptr;
+    if (n <= kMaxSmall && ready()) {
+        std::size_t cls = aligned_class(n, align);
+        if (cls < kClasses) p = small_alloc(cls);
+    }
+    if (!p) p = __libc_memalign(align, n);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+void* aligned_alloc(std::size_t align, std::size_t n) {
+    void* p = nullptr;
+    return posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, n) == 0 ? p : nullptr;
+}
+
+void* memalign(std::size_t align, std::size_t n) {
+    return aligned_alloc(align, n);
+}
+
+std::size_t malloc_usable_size(void* p) {
+    if (!p) return 0;
+    std::size_t cls = owner_class(p);
+    return cls < kClasses ? kClassSizes[cls] : foreign_usable_size(p);
+}
+
+} // extern "C"
@@ -34,6 +34,8 @@
  * 6. 申请空间大小依据操作系统的内存页面大小,最高效利用内存,杜绝内部碎片。并且以分段方式动态申请内存进行对象池扩容。 / The size of the allocated space is determined by the memory page size of the operating system. This ensures the most efficient use of memory and eliminates internal fragmentation. And dynamically apply for memory in segments to expand the object pool.
  * 7. 适用于即时消息、高频交易系统、游戏数据等性能敏感场景 / Suitable for IM, high frequency trading,game data, and other performance-sensitive scenarios
  * 8. 带有Atomic APIs 可以用于并发环境创建和回收对象 / With the Atomic API, objects can be created and reclaimed in a concurrent environment.
+ * 9. 可选类级 operator new/delete，让 new/delete 直接走对象池 / Optional class-level operator new/delete so plain new/delete go through the pool.
+ * 10. 每个段带占用位图与槽位代数旁路表，可按位图遍历存活对象 / Each segment keeps an occupancy bitmap and slot generations in a side table; live objects can be iterated by bitmap.
 
  */
 
@@ -41,6 +43,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <new>
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <type_traits>
@@ -48,6 +51,15 @@
 #include <utility>
 #include <iostream>
 #include <algorithm>
+#include <bit>
+#include <chrono>
+#include <functional>
+#include <array>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+#include <cstring>
+#include <cstdlib>
 #include <unistd.h>
 
 #if defined(_WIN32)
@@ -55,6 +67,24 @@
   #include <windows.h>
 #endif
 
+#if defined(__linux__)
+  #include <fcntl.h>
+#endif
+
+#if !defined(_WIN32)
+  #include <sys/mman.h>
+#endif
+
+// 不内联的冷路径，让 allocate/deallocate 的常见路径小到能内联进调用方
+// Rare paths kept out of line, so the common path of allocate/deallocate stays small enough to inline
+#if defined(__GNUC__)
+  #define SEGMENTED_POOL_NOINLINE [[gnu::noinline]]
+#elif defined(_MSC_VER)
+  #define SEGMENTED_POOL_NOINLINE __declspec(noinline)
+#else
+  #define SEGMENTED_POOL_NOINLINE
+#endif
+
 namespace detail {
 inline std::size_t os_page_size() noexcept {
 #if defined(_WIN32)
@@ -86,8 +116,378 @@ constexpr std::size_t round_up(std::size_t x, std::size_t align) noexcept {
     std::size_t r = x % align;
     return r ? (x + (align - r)) : x;
 }
+
+// 除以 d 的定点倒数：x < 2^32 时 (x * r) >> 64 等于 x / d，免去指针换算槽位时的除法
+// Fixed-point reciprocal of d: (x * r) >> 64 equals x / d for x < 2^32, sparing the division when
+// a pointer is turned into a slot index
+constexpr std::uint64_t reciprocal(std::size_t d) noexcept { return ~std::uint64_t(0) / d + 1; }
+
+inline std::size_t divide(std::size_t x, std::size_t d, std::uint64_t r) noexcept {
+#if defined(__SIZEOF_INT128__)
+    if ((x >> 32) == 0 && (d >> 32) == 0)
+        return static_cast<std::size_t>((__extension__ static_cast<unsigned __int128>(x) * r) >> 64);
+#endif
+    (void)r;
+    return x / d;
+}
+
+// 段的最小页数：页大小与槽位大小的最小公倍数，不留内部碎片
+// Minimum pages per segment: lcm of page and slot size, so no slot straddles the end
+constexpr std::size_t min_segment_pages(std::size_t page_size, std::size_t slot_size,
+                                        std::size_t user_min_pages = 0) noexcept {
+    std::size_t min_pages = lcm(page_size, slot_size) / page_size;
+    if (user_min_pages > 0) {
+        std::size_t k = (user_min_pages + min_pages - 1) / min_pages;
+        min_pages *= k;
+    }
+    return min_pages;
+}
+
+// x 的最低位 2 的幂 / Lowest power of two dividing x
+constexpr std::size_t low_bit(std::size_t x) noexcept {
+    return x & (~x + 1);
+}
+
+// ----------------------------
+// 内置 LZ 压缩：LZ4 风格的序列（令牌、字面量、16 位距离、匹配长度），用于冷段
+// Built-in LZ codec: LZ4-style sequences (token, literals, 16-bit distance, match length), used for cold segments
+// ----------------------------
+inline void lz_put_length_(std::vector<std::byte>& out, std::size_t n) {
+    for (; n >= 255; n -= 255) out.push_back(std::byte{255});
+    out.push_back(static_cast<std::byte>(n));
+}
+
+inline std::uint32_t lz_read32_(const std::byte* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void lz_compress(const std::byte* in, std::size_t n, std::vector<std::byte>& out) {
+    constexpr std::size_t min_match = 4, hash_bits = 12;
+    std::vector<std::uint32_t> table(std::size_t(1) << hash_bits, 0xFFFFFFFFu);
+    auto emit = [&](std::size_t lit_begin, std::size_t lit_end, std::size_t distance, std::size_t match) {
+        const std::size_t lits = lit_end - lit_begin;
+        const std::size_t m = match ? match - min_match : 0;
+        out.push_back(static_cast<std::byte>((std::min<std::size_t>(lits, 15) << 4) | std::min<std::size_t>(m, 15)));
+        if (lits >= 15) lz_put_length_(out, lits - 15);
+        out.insert(out.end(), in + lit_begin, in + lit_end);
+        if (!match) return;
+        out.push_back(static_cast<std::byte>(distance & 0xFF));
+        out.push_back(static_cast<std::byte>(distance >> 8));
+        if (m >= 15) lz_put_length_(out, m - 15);
+    };
+    std::size_t pos = 0, anchor = 0;
+    while (pos + min_match <= n) {
+        const std::uint32_t word = lz_read32_(in + pos);
+        const std::size_t h = (word * 2654435761u) >> (32 - hash_bits);
+        const std::uint32_t cand = table[h];
+        table[h] = static_cast<std::uint32_t>(pos);
+        if (cand != 0xFFFFFFFFu && pos - cand <= 0xFFFF && lz_read32_(in + cand) == word) {
+            std::size_t len = min_match;
+            while (pos + len < n && in[cand + len] == in[pos + len]) ++len;
+            emit(anchor, pos, pos - cand, len);
+            pos += len;
+            anchor = pos;
+        } else {
+            ++pos;
+        }
+    }
+    emit(anchor, n, 0, 0);
+}
+
+// 解压到恰好 n 字节，输入损坏时返回 false / Decompress into exactly n bytes; false on malformed input
+inline bool lz_decompress(const std::byte* in, std::size_t in_n, std::byte* out, std::size_t n) noexcept {
+    const std::byte* const in_end = in + in_n;
+    std::size_t pos = 0;
+    auto get_length = [&](std::size_t base) -> std::size_t {
+        if (base != 15) return base;
+        for (std::size_t b = 255; b == 255 && in < in_end;) { b = static_cast<std::size_t>(*in++); base += b; }
+        return base;
+    };
+    while (in < in_end) {
+        const auto token = static_cast<std::size_t>(*in++);
+        const std::size_t lits = get_length(token >> 4);
+        if (lits > static_cast<std::size_t>(in_end - in) || lits > n - pos) return false;
+        std::memcpy(out + pos, in, lits);
+        in += lits;
+        pos += lits;
+        if (in == in_end) break;
+        if (in_end - in < 2) return false;
+        const std::size_t distance = static_cast<std::size_t>(in[0]) | static_cast<std::size_t>(in[1]) << 8;
+        in += 2;
+        const std::size_t match = get_length(token & 15) + 4;
+        if (distance == 0 || distance > pos || match > n - pos) return false;
+        for (std::size_t k = 0; k < match; ++k, ++pos) out[pos] = out[pos - distance];   // 可能重叠 / May overlap
+    }
+    return pos == n;
+}
+
+// 页号到段下标的两级基数表：段按页对齐且为整页，地址右移即得页号，查找为 O(1)。
+// 两级数组都用 calloc 申请，未写过的部分不占物理内存。
+// Two-level radix table from page number to segment index. Segments are page aligned and whole
+// pages long, so a shifted address is its page and a lookup is O(1). Both levels come from calloc,
+// so parts never written take no physical memory.
+class PageMap {
+public:
+    explicit PageMap(std::size_t page_size) noexcept
+    : shift_(static_cast<unsigned>(std::countr_zero(page_size))),
+      root_size_(shift_ + leaf_bits < address_bits
+                 ? std::size_t{1} << (address_bits - shift_ - leaf_bits) : 1) {}
+    ~PageMap() { reset(); std::free(root_); }
+    PageMap(const PageMap&) = delete;
+    PageMap& operator=(const PageMap&) = delete;
+
+    // 0 表示未登记，否则为段下标 + 1 / 0 when unmapped, otherwise segment index + 1
+    std::uint32_t find(const void* p) const noexcept {
+        const std::uintptr_t page = reinterpret_cast<std::uintptr_t>(p) >> shift_;
+        const std::uintptr_t hi = page >> leaf_bits;
+        if (hi >= root_size_ || !root_ || !root_[hi]) return 0;
+        return root_[hi][page & leaf_mask];
+    }
+
+    // 把 [p, p + bytes) 的页登记为 value（0 即注销）；地址越界或申请失败时记为不完整
+    // Map the pages of [p, p + bytes) to value (0 unmaps); out-of-range addresses or a failed
+    // allocation mark the table incomplete
+    void assign(const void* p, std::size_t bytes, std::uint32_t value) noexcept {
+        const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(p) >> shift_;
+        const std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(p) + bytes - 1) >> shift_;
+        if (!root_ && value) root_ = static_cast<std::uint32_t**>(std::calloc(root_size_, sizeof(std::uint32_t*)));
+        for (std::uintptr_t page = first; page <= last; ++page) {
+            const std::uintptr_t hi = page >> leaf_bits;
+            if (hi >= root_size_ || !root_) { if (!value) continue; complete_ = false; return; }
+            if (!root_[hi]) {
+                if (!value) continue;
+                root_[hi] = static_cast<std::uint32_t*>(std::calloc(leaf_mask + 1, sizeof(std::uint32_t)));
+                if (!root_[hi]) { complete_ = false; return; }
+            }
+            root_[hi][page & leaf_mask] = value;
+        }
+    }
+
+    // 为 false 时 find 返回 0 不代表地址不在池内 / When false, a 0 from find does not prove a foreign address
+    bool complete() const noexcept { return complete_; }
+
+    void reset() noexcept {
+        if (root_) for (std::size_t i = 0; i < root_size_; ++i) { std::free(root_[i]); root_[i] = nullptr; }
+        complete_ = true;
+    }
+
+private:
+    static constexpr unsigned address_bits = 48;   // 用户态虚拟地址位数 / User-space virtual address bits
+    static constexpr unsigned leaf_bits = 18;
+    static constexpr std::uintptr_t leaf_mask = (std::uintptr_t{1} << leaf_bits) - 1;
+
+    unsigned shift_;
+    std::size_t root_size_;
+    std::uint32_t** root_ = nullptr;
+    bool complete_ = true;
+};
+
+#if defined(__linux__)
+// 段所在的内存文件，父池与各 fork 共享，最后一个持有者关闭
+// Memory file holding the segments; shared by a pool and its forks, closed by the last owner
+struct MemFile {
+    int fd = -1;
+    std::size_t size = 0;
+
+    explicit MemFile(const char* name) : fd(::memfd_create(name, MFD_CLOEXEC)) {
+        if (fd < 0) throw std::bad_alloc();
+    }
+    // 接管已打开的普通文件 / Take over an already opened regular file
+    explicit MemFile(int file) noexcept : fd(file) {}
+    ~MemFile() { if (fd >= 0) ::close(fd); }
+    MemFile(const MemFile&) = delete;
+    MemFile& operator=(const MemFile&) = delete;
+};
+#endif
 } // namespace detail
 
+// ----------------------------
+// 段内存来源 / Where segment memory comes from
+// ----------------------------
+enum class PoolBacking {
+    heap,     // ::operator new
+    memfd,    // memfd 上的 MAP_SHARED 映射，可 fork / MAP_SHARED slices of a memfd, forkable (Linux)
+    file,     // 无名交换文件上的 MAP_SHARED 映射，由内核换入换出，见 open_swap_file / MAP_SHARED slices of an unnamed swap file, paged by the kernel; see open_swap_file (Linux)
+};
+
+// ----------------------------
+// PooledObject 可选特性 / Optional PooledObject features
+// ----------------------------
+enum PoolFeature : unsigned {
+    pool_default    = 0,
+    pool_route_new  = 1u << 0,  // 类级 operator new/delete 走对象池 / Route class-level operator new/delete into the pool
+    pool_side_table = 1u << 1,  // 回收标记只放在池的旁路表中 / Keep the recycled flag only in the pool's side table
+};
+
+// ----------------------------
+// 分配提示 / Allocation hints
+// 同一提示的对象只放进同一组段，寿命不同的对象不会互相钉住段
+// Objects with the same hint share one set of segments, so short-lived objects
+// never pin the segments of long-lived ones
+// ----------------------------
+struct AllocHint {
+    std::uint32_t set = 0;   // 段组编号，可自定义 / Segment set id, user-defined ids allowed
+    std::uint32_t gen = 0;   // 对象组的代数，组释放后旧提示失效 / Group generation; old hints lapse once the group is released
+};
+
+template <class T> class pool_ptr;
+
+// ----------------------------
+// 槽位句柄：32 位全局槽位编号 + 代数，对象被回收后解析失败
+// Slot handle: 32-bit global slot index plus generation; resolving fails once the object is recycled
+// ----------------------------
+struct SlotHandle {
+    static constexpr std::uint32_t invalid = 0xFFFFFFFFu;
+    std::uint32_t index = invalid;
+    std::uint32_t gen = 0;
+
+    explicit operator bool() const noexcept { return index != invalid; }
+    friend bool operator==(SlotHandle, SlotHandle) = default;
+};
+
+// ----------------------------
+// 池统计：直方图按 2 的幂分桶，第 i 桶为 [2^(i-1), 2^i) 纳秒，只统计被采样的对象
+// Pool statistics: histograms use power-of-two buckets, bucket i covering [2^(i-1), 2^i) ns,
+// and count sampled objects only
+// ----------------------------
+struct PoolStats {
+    std::size_t live = 0;                     // 存活对象 / Live objects
+    std::size_t segments = 0;                 // 段数 / Segments
+    std::size_t capacity = 0;                 // 总槽位 / Total slots
+    std::size_t slot_size = 0;
+    std::size_t bytes = 0;                    // 段占用的字节 / Bytes held by segments
+    std::uint32_t sample_every = 0;           // 采样间隔，0 表示未开启 / Sampling interval; 0 when off
+    std::array<std::uint64_t, 64> lifetime_ns{};   // 已回收对象的寿命 / Lifetimes of recycled objects
+    std::array<std::uint64_t, 64> age_ns{};        // 存活对象的年龄 / Ages of live objects
+};
+
+// 分配优先级：high 可以使用为它保留的容量 / Allocation priority: high may use the capacity reserved for it
+enum class priority : std::uint8_t { normal, high };
+
+inline constexpr AllocHint hint_default{0};
+inline constexpr AllocHint hint_short_lived{1};
+inline constexpr AllocHint hint_long_lived{2};
+
+// 自定义段组编号须小于此值，create_group 的编号从这里开始，两者互不重叠
+// User-defined set ids must be below this; create_group hands out ids from here on, so the two never overlap
+inline constexpr std::uint32_t max_hint_sets = 64;
+
+// ----------------------------
+// 全局对象池登记表：每个对象池构造时加入、析构时退出。提供汇总统计、跨类型的总字节预算
+// 与按类型的软限制：低于软限制的池总能增长，超过软限制的池只在总量未超预算时增长，否则
+// 新段分配抛出 std::bad_alloc。汇总统计与 trim_all 使用各池的 atomic_* 接口。
+// Global pool registry: every pool joins on construction and leaves on destruction. It offers
+// aggregated stats, a byte budget shared across types and per-type soft limits: a pool below its
+// soft limit can always grow, one above it grows only while the total is within budget, otherwise
+// adding a segment throws std::bad_alloc. Aggregated stats and trim_all use each pool's atomic_* API.
+// ----------------------------
+class PoolRegistry {
+public:
+    struct Entry {
+        void* pool;
+        std::type_index type;
+        PoolStats (*stats)(void*);
+        std::size_t (*trim)(void*);
+        std::atomic<std::size_t> bytes{0};
+        std::atomic<std::size_t> soft_limit{0};
+    };
+
+    struct PoolInfo {
+        const char* type;             // typeid(T).name()
+        std::size_t soft_limit;
+        PoolStats stats;
+    };
+
+    static PoolRegistry& instance() {
+        static PoolRegistry inst;
+        return inst;
+    }
+
+    void set_budget(std::size_t bytes) noexcept { budget_ = bytes; }
+    std::size_t budget() const noexcept { return budget_; }
+    std::size_t bytes() const noexcept { return total_; }
+
+    // 设置某类型所有池（包括以后创建的）的软限制 / Soft limit for every pool of T, including later ones
+    template <class T>
+    void set_soft_limit(std::size_t bytes) {
+        std::lock_guard<std::mutex> g(mutex_);
+        const std::type_index type(typeid(T));
+        std::erase_if(soft_limits_, [&](auto const& kv) { return kv.first == type; });
+        soft_limits_.emplace_back(type, bytes);
+        for (auto& e : entries_) if (e->type == type) e->soft_limit = bytes;
+    }
+
+    std::vector<PoolInfo> pools() {
+        std::lock_guard<std::mutex> g(mutex_);
+        std::vector<PoolInfo> out;
+        out.reserve(entries_.size());
+        for (auto& e : entries_) out.push_back({e->type.name(), e->soft_limit, e->stats(e->pool)});
+        return out;
+    }
+
+    // 所有池的统计之和，slot_size 与 sample_every 无意义置 0 / Sum over all pools; slot_size and sample_every are 0
+    PoolStats total() {
+        PoolStats sum;
+        for (auto const& info : pools()) {
+            sum.live += info.stats.live;
+            sum.segments += info.stats.segments;
+            sum.capacity += info.stats.capacity;
+            sum.bytes += info.stats.bytes;
+            for (std::size_t i = 0; i < sum.lifetime_ns.size(); ++i) {
+                sum.lifetime_ns[i] += info.stats.lifetime_ns[i];
+                sum.age_ns[i] += info.stats.age_ns[i];
+            }
+        }
+        return sum;
+    }
+
+    // 对所有池执行 atomic_trim，返回释放的段数 / atomic_trim every pool; returns segments released
+    std::size_t trim_all() {
+        std::lock_guard<std::mutex> g(mutex_);
+        std::size_t released = 0;
+        for (auto& e : entries_) released += e->trim(e->pool);
+        return released;
+    }
+
+    Entry* join(void* pool, std::type_index type, PoolStats (*stats)(void*), std::size_t (*trim)(void*)) {
+        std::lock_guard<std::mutex> g(mutex_);
+        entries_.push_back(std::unique_ptr<Entry>(new Entry{pool, type, stats, trim}));
+        for (auto const& kv : soft_limits_) if (kv.first == type) entries_.back()->soft_limit = kv.second;
+        return entries_.back().get();
+    }
+
+    void leave(Entry* e) noexcept {
+        std::lock_guard<std::mutex> g(mutex_);
+        total_ -= e->bytes;
+        std::erase_if(entries_, [e](auto const& p) { return p.get() == e; });
+    }
+
+    // 新段记账，超出预算且超过软限制时返回 false / Account a new segment; false when over budget and over the soft limit
+    bool charge(Entry* e, std::size_t n, bool force = false) noexcept {
+        const std::size_t total = total_.fetch_add(n) + n;
+        const std::size_t mine = e->bytes.fetch_add(n) + n;
+        if (force || total <= budget_ || mine <= e->soft_limit) return true;
+        discharge(e, n);
+        return false;
+    }
+
+    void discharge(Entry* e, std::size_t n) noexcept {
+        total_ -= n;
+        e->bytes -= n;
+    }
+
+private:
+    PoolRegistry() = default;
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::vector<std::pair<std::type_index, std::size_t>> soft_limits_;
+    std::atomic<std::size_t> total_{0};
+    std::atomic<std::size_t> budget_{SIZE_MAX};
+};
+
 // ----------------------------
 // SegmentedObjectPool 定义 / Definition
 // ----------------------------
@@ -99,9 +499,71 @@ class SegmentedObjectPool {
         std::byte* data = nullptr;                // 内存块 / Memory block
         std::size_t capacity = 0;                 // 可容纳对象数 / Number of objects
         std::size_t next_uninit = 0;              // 尚未构造的下一个索引 / Next uninitialized index
+        std::uint32_t set = 0;                    // 所属段组 / Segment set it belongs to
+        std::uint32_t first_index = 0;            // 第一个槽位的全局编号 / Global index of the first slot
+        std::uint8_t mapping = 0;                 // 内存来源，见 Mapping / Memory source, see Mapping
+        std::size_t file_offset = 0;              // 在内存文件中的偏移 / Offset in the memory file
+        std::uint64_t serial = 0;                 // 段序列号，区分复用的段下标 / Segment serial, tells reused indices apart
+
+        // 槽位旁路表，不占用对象本身的缓存行 / Per-slot side table, kept out of the objects' cache lines
+        std::unique_ptr<std::uint64_t[]> used;    // 占用位图 / Occupancy bitmap
+        std::unique_ptr<std::uint32_t[]> gen;     // 槽位代数，每次回收加一 / Slot generation, bumped on every deallocation
+        std::unique_ptr<std::uint64_t[]> dirty_pages;   // 上次检查点后写过的页 / Pages written since the last checkpoint
+        bool meta_dirty = false;                  // 位图或代数有变化 / Bitmap or generations changed
+        std::unique_ptr<std::uint64_t[]> changed; // 逐槽变更位图 / Per-slot change bitmap
+        bool any_changed = false;                 // 有槽位被 mark_dirty / Some slot was marked since the last pass
+        std::unique_ptr<std::atomic<std::uint64_t>[]> seq;   // 顺序锁：高 32 位代数，低 32 位序号 / Seqlock: generation high, sequence low
+        std::unique_ptr<std::uint64_t[]> born;    // 采样对象的分配时刻，0 表示未采样 / Allocation time of sampled objects; 0 if unsampled
+        std::unique_ptr<std::byte[]> packed;      // 冷段的压缩内容，非空表示页面已释放 / Compressed contents of a cold segment; set while its pages are released
+        std::size_t packed_bytes = 0;
+        std::uint64_t touched = 0;                // 最近访问所在的冷段扫描轮次 / Cold-tier sweep during which it was last accessed
+        std::uint64_t idle_since = 0;             // 开始空闲的时刻 / When it went idle
 
         Segment() = default;
-        Segment(std::byte* d, std::size_t cap) : data(d), capacity(cap), next_uninit(0) /*free_flags(cap, 0), free_hint(0)*/ {}
+        Segment(std::byte* d, std::size_t cap, std::uint32_t s)
+        : data(d), capacity(cap), next_uninit(0), set(s),
+          used(std::make_unique<std::uint64_t[]>((cap + 63) / 64)),
+          gen(std::make_unique<std::uint32_t[]>(cap)) {}
+
+        std::byte* end(std::size_t slot_size) const noexcept { return data + capacity * slot_size; }
+        std::size_t pages(std::size_t slot_size, std::size_t page_size) const noexcept {
+            return (capacity * slot_size + page_size - 1) / page_size;
+        }
+        bool is_used(std::size_t i) const noexcept { return (used[i >> 6] >> (i & 63)) & 1u; }
+        void set_used(std::size_t i) noexcept { used[i >> 6] |= std::uint64_t(1) << (i & 63); }
+        void clear_used(std::size_t i) noexcept { used[i >> 6] &= ~(std::uint64_t(1) << (i & 63)); ++gen[i]; }
+        bool empty() const noexcept {
+            for (std::size_t w = 0, n = (next_uninit + 63) / 64; w < n; ++w) if (used[w]) return false;
+            return true;
+        }
+    };
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    enum Mapping : std::uint8_t {
+        map_heap = 0,       // ::operator new
+        map_shared = 1,     // 内存文件的 MAP_SHARED 映射 / MAP_SHARED view of the memory file
+        map_private = 2,    // 内存文件的 MAP_PRIVATE 映射（fork 继承的段） / MAP_PRIVATE view (segments inherited by a fork)
+    };
+
+    // 空闲栈条目带着段下标和槽位，出栈时不必查段
+    // Free-stack entry carrying its segment index and slot, so a pop needs no lookup
+    struct FreeSlot {
+        T* obj;
+        std::uint32_t seg;
+        std::uint32_t slot;
+    };
+
+    // 段组：各自的段、空闲栈、正在切分的段和增长提示
+    // Segment set: its own segments, free stack, the segment being carved and the growth hint
+    struct SegmentSet {
+        std::vector<FreeSlot> free;               // 空闲对象栈 / Free objects stack
+        std::vector<std::size_t> segs;            // 属于本组的段下标，按地址排序 / Indices of the set's segments, by address
+        std::size_t current = npos;               // 正在切分的段下标 / Index of the segment being carved
+        std::size_t next_pages_hint = 0;
+        std::size_t stale = 0;                    // allocate_near 留下的过期条目估计 / Estimated stale entries left by allocate_near
+        bool group = false;                       // 由 create_group 创建且尚未释放 / Created by create_group and not yet released
+        std::uint32_t gen = 0;                    // 组编号的代数，每次释放加一 / Generation of the group id, bumped on every release
     };
 
     // 用于线程安全场景的自旋锁 Spin lock for thread-safe scenarios
@@ -128,7 +590,7 @@ class SegmentedObjectPool {
         ~LockGuard() { lock.unlock(); }
     };
 
-    std::stack<T*> free_stack_;   // 空闲对象栈 Free objects stack
+    std::vector<SegmentSet> sets_{1};   // 下标即 AllocHint::set / Indexed by AllocHint::set
 
 public:
     using value_type = T;
@@ -138,185 +600,2334 @@ public:
         return inst;
     }
 
-    explicit SegmentedObjectPool(std::size_t min_pages_per_segment = 0, double growth = 1.0)
-    : page_size_(detail::os_page_size()),
+    explicit SegmentedObjectPool(std::size_t min_pages_per_segment = 0, double growth = 1.0,
+                                 PoolBacking backing = PoolBacking::heap)
+    : backing_(backing),
+      page_size_(detail::os_page_size()),
       slot_size_(detail::round_up(std::max(sizeof(T), sizeof(void*)), alignof(T))),
+      slot_recip_(detail::reciprocal(slot_size_)),
+      seg_align_(std::max<std::size_t>(alignof(T), page_size_)),
       pages_per_segment_base_(compute_min_pages(min_pages_per_segment)),
-      growth_factor_(growth > 1.0 ? growth : 1.0) {}
+      dir_unit_(pages_per_segment_base_ * page_size_ / slot_size_),
+      growth_factor_(growth > 1.0 ? growth : 1.0),
+      registry_(PoolRegistry::instance().join(this, typeid(T),
+          [](void* p) { return static_cast<SegmentedObjectPool*>(p)->atomic_stats(); },
+          [](void* p) { return static_cast<SegmentedObjectPool*>(p)->atomic_trim(); })) {}
 
-    ~SegmentedObjectPool() { clear(); }
+    ~SegmentedObjectPool() {
+        clear();
+        PoolRegistry::instance().leave(registry_);
+    }
     SegmentedObjectPool(const SegmentedObjectPool&) = delete;
     SegmentedObjectPool& operator=(const SegmentedObjectPool&) = delete;
 
     // 分配对象 / Allocate object
     template <class... Args>
     T* allocate(Args&&... args) {
-        // 1. 优先使用 stack 中的空闲对象
-        if (!free_stack_.empty()) {
-            T* obj = free_stack_.top();
-            free_stack_.pop();
-            new (obj) T(std::forward<Args>(args)...);
-            obj->mark_in_use();
-            ++live_count_;
-            return obj;
-        }
+        return construct_(acquire_slot_(0), std::forward<Args>(args)...);
+    }
 
-        // 2. 分配未初始化空间
-        if (!segments_.empty()) {
-            Segment& seg = segments_.back();
-            if (seg.next_uninit < seg.capacity) {
-                std::byte* ptr = seg.data + seg.next_uninit * slot_size_;
-                ++seg.next_uninit;
-                T* obj = reinterpret_cast<T*>(ptr);
-                new (obj) T(std::forward<Args>(args)...);
-                obj->mark_in_use();
-                ++live_count_;
-                return obj;
-            }
-        }
+    // 按提示分配到对应段组；编号不小于 max_hint_sets 时必须是现存的组且代数相符，否则返回 nullptr
+    // Allocate into the segment set selected by the hint; an id at or past max_hint_sets must name a
+    // live group of the same generation, otherwise nullptr is returned
+    template <class... Args>
+    T* allocate(AllocHint hint, Args&&... args) {
+        if (!open_set_(hint)) return nullptr;
+        return construct_(acquire_slot_(hint.set), std::forward<Args>(args)...);
+    }
 
-        // 3. 扩容新段
-        add_segment_();
-        Segment& seg = segments_.back();
-        std::byte* ptr = seg.data + seg.next_uninit * slot_size_;
-        ++seg.next_uninit;
-        T* obj = reinterpret_cast<T*>(ptr);
-        new (obj) T(std::forward<Args>(args)...);
-        obj->mark_in_use();
-        ++live_count_;
-        return obj;
+    // 按优先级分配：normal 与普通 allocate 相同，high 可以用到 set_priority_reserve 保留的容量
+    // Allocate by priority: normal is plain allocate, high may dip into the capacity kept by set_priority_reserve
+    template <class... Args>
+    T* allocate(priority p, Args&&... args) {
+        if (p == priority::normal) return allocate(std::forward<Args>(args)...);
+        return construct_(acquire_slot_(0, limit_high_), std::forward<Args>(args)...);
+    }
+
+    // 存活对象上限为 max_live，其中 high_fraction 只留给 priority::high；超过时分配返回 nullptr
+    // Cap live objects at max_live and keep high_fraction of that for priority::high; allocations over the limit return nullptr
+    void set_priority_reserve(std::size_t max_live, double high_fraction) noexcept {
+        limit_high_ = max_live;
+        limit_low_ = max_live - static_cast<std::size_t>(static_cast<double>(max_live) * std::clamp(high_fraction, 0.0, 1.0));
+    }
+
+    // 靠近 hint 分配：优先同一页，其次同一段，最后退回 hint 所在段组的普通分配。
+    // hint 必须是本池的对象：不同类型的对象在不同的池里，无法放进同一页。
+    // Allocate near hint: same page first, then same segment, then the normal path of hint's set.
+    // hint must be an object of this pool: objects of another type live in another pool and
+    // cannot share its pages.
+    template <class... Args>
+    T* allocate_near(const T* hint, Args&&... args) {
+        if (live_count_ >= limit_low_) return nullptr;
+        std::size_t h;
+        Segment* seg = hint ? locate_(hint, h) : nullptr;
+        if (!seg) return allocate(std::forward<Args>(args)...);
+
+        const std::size_t page_lo = (h * slot_size_) / page_size_ * page_size_;
+        const std::size_t lo = page_lo / slot_size_;
+        const std::size_t hi = std::min(seg->capacity, (page_lo + page_size_ + slot_size_ - 1) / slot_size_);
+        std::size_t i = find_free_near_(*seg, h, lo, hi);
+        if (i == npos) i = find_free_near_(*seg, h, 0, seg->capacity);
+        if (i == npos) return construct_(acquire_slot_(seg->set), std::forward<Args>(args)...);
+        if (cold_tier_) warm_(*seg);
+
+        // 空闲栈中对应的条目留作过期条目，出栈时跳过，过多时由 compact_free_ 清理
+        // Its free-stack entry goes stale; pops skip it, and compact_free_ sweeps them once they pile up
+        if (i == seg->next_uninit) ++seg->next_uninit;
+        else ++sets_[seg->set].stale;
+        seg->set_used(i);
+        return construct_(seg->data + i * slot_size_, std::forward<Args>(args)...);
     }
 
     // 回收对象 / Deallocate object
     void deallocate(T* p) noexcept {
         
         if (!p) return;
+        assert(reorder_jobs_ == 0 && "deallocation while a ReorderJob is active");
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (seg && cold_tier_) warm_(*seg);
         p->~T();
-        free_stack_.push(p);  // 直接压入 stack
+        if (seg) release_in_(*seg, slot, p);
         --live_count_;
+    }
 
+    // 池代为回收对象：与 PooledObject::recycle 相同，先调用 reset 并记下已回收，再 deallocate。
+    // 定时器到期、事务回滚、release_group 和 collect 都经由这里
+    // Recycle on the object's behalf: like PooledObject::recycle, run reset and flag the object
+    // recycled, then deallocate. Timer expiry, rollback, release_group and collect all go through here
+    void recycle(T* p) noexcept {
+        if (!p) return;
+        recycle_hook_(*p);
+        deallocate(p);
     }
 
-    // =============================================================
-    // 🔒 线程安全 API（池内部同步）
-    // Thread-safe API (internal synchronization within the pool)
-    // =============================================================
-    template <class... Args>
-    T* atomic_allocate(Args&&... args) {
-        LockGuard g(lock_);
-        return allocate(std::forward<Args>(args)...);
+    // 分配未构造的槽位，供 operator new 使用 / Allocate an unconstructed slot, used by operator new
+    void* allocate_raw() {
+        void* slot = acquire_slot_(0);
+        if (!slot) return nullptr;
+        if (dirty_tracking_) touch_allocated_(slot);
+        if (sample_every_ && --sample_countdown_ == 0) sample_birth_(slot);
+        ++live_count_;
+        return slot;
     }
 
-    void atomic_deallocate(T* p) noexcept {
+    // 归还槽位（对象已由调用方析构） / Return a slot whose object the caller already destroyed
+    void deallocate_raw(void* p) noexcept {
         if (!p) return;
-        LockGuard g(lock_);
-        deallocate(p);
+        assert(reorder_jobs_ == 0 && "deallocation while a ReorderJob is active");
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (seg && cold_tier_) warm_(*seg);
+        if (seg) release_in_(*seg, slot, static_cast<T*>(p));
+        --live_count_;
     }
 
-    void atomic_clear() noexcept {
-        LockGuard g(lock_);
-        clear();
+    // 大小为 size、对齐为 align 的对象能否放入槽位 / Whether an object of this size and alignment fits a slot
+    bool fits(std::size_t size, std::size_t align) const noexcept {
+        return size <= slot_size_ && slot_alignment() % align == 0;
     }
 
-    // 清空池子 / Clear all memory
-    void clear() noexcept {
-        for (auto& seg : segments_) {
-            ::operator delete[](seg.data, std::align_val_t(alignof(T)));
-            seg.data = nullptr;
-        }
-        segments_.clear();
-        live_count_ = 0;
-        next_pages_hint_ = pages_per_segment_base_;
+    // 是否为本池的槽位 / Whether p is a slot of this pool
+    bool contains(const void* p) const noexcept {
+        std::size_t slot;
+        return locate_(p, slot) != nullptr;
     }
 
-    std::size_t live() const noexcept { return live_count_; }
-    std::size_t segments() const noexcept { return segments_.size(); }
-    std::size_t capacity_total() const noexcept {
-        std::size_t c = 0; for (auto const& s : segments_) c += s.capacity; return c; }
+    // 通过旁路表判断对象是否已回收，p 可为对象内任意地址
+    // Whether the object is recycled, answered from the side table; p may point anywhere inside the object
+    bool is_recycled(const void* p) const noexcept {
+        std::size_t slot;
+        const Segment* seg = locate_(p, slot);
+        return !seg || !seg->is_used(slot);
+    }
 
-private:
-    
-    // 分配和回收操作的具体实现
-    // The specific implementation of allocation and recycling operations
+    // 槽位当前代数，回收后变化 / Current generation of the slot; changes when it is recycled
+    std::uint32_t generation(const void* p) const noexcept {
+        std::size_t slot;
+        const Segment* seg = locate_(p, slot);
+        return seg ? seg->gen[slot] : 0;
+    }
 
-    std::size_t compute_min_pages(std::size_t user_min_pages) const noexcept {
-        const std::size_t ps = page_size_;
-        const std::size_t ss = slot_size_;
-        const std::size_t l = detail::lcm(ps, ss);
-        std::size_t min_pages = l / ps;
-        if (user_min_pages > 0) {
-            std::size_t k = (user_min_pages + min_pages - 1) / min_pages;
-            min_pages *= k;
-        }
-        return min_pages;
+    // 对象的句柄，p 不属于本池时返回无效句柄 / Handle of an object; invalid if p is not in this pool
+    SlotHandle handle_of(const void* p) const noexcept {
+        std::size_t slot;
+        const Segment* seg = locate_(p, slot);
+        if (!seg) return {};
+        return SlotHandle{seg->first_index + static_cast<std::uint32_t>(slot), seg->gen[slot]};
     }
 
-    void add_segment_() {
-        if (segments_.empty()) {
-            next_pages_hint_ = pages_per_segment_base_;
-        } else {
-            double target = static_cast<double>(next_pages_hint_) * growth_factor_;
-            std::size_t pages = static_cast<std::size_t>(target);
-            if (pages < next_pages_hint_ + pages_per_segment_base_)
-                pages = next_pages_hint_ + pages_per_segment_base_;
-            std::size_t rem = pages % pages_per_segment_base_;
-            if (rem) pages += (pages_per_segment_base_ - rem);
-            next_pages_hint_ = pages;
-        }
-        const std::size_t seg_bytes = next_pages_hint_ * page_size_;
-        const std::size_t capacity = seg_bytes / slot_size_;
-        std::byte* raw = reinterpret_cast<std::byte*>(::operator new[](seg_bytes, std::align_val_t(alignof(T))));
-        segments_.emplace_back(raw, capacity);
+    // 解析句柄：O(1) 查目录，槽位已回收或代数不符时返回 nullptr
+    // Resolve a handle with an O(1) directory lookup; nullptr if the slot was recycled or reused
+    // 非 const：访问会解压冷段 / Not const: an access decompresses a cold segment
+    T* resolve(SlotHandle h) noexcept {
+        std::size_t slot;
+        Segment* seg = segment_of_index_(h.index, slot);
+        if (!seg || !seg->is_used(slot) || seg->gen[slot] != h.gen) return nullptr;
+        if (cold_tier_) warm_(*seg);
+        return reinterpret_cast<T*>(seg->data + slot * slot_size_);
     }
 
-private:
-    std::vector<Segment> segments_;
-    std::size_t page_size_ = detail::os_page_size();
-    std::size_t slot_size_ = 0;
-    std::size_t pages_per_segment_base_ = 0;
-    double growth_factor_ = 1.0;
-    std::size_t next_pages_hint_ = 0;
-    std::size_t live_count_ = 0;
+    // 对象的 32 位全局槽位编号，p 不属于本池时返回 SlotHandle::invalid
+    // 32-bit global slot index of an object; SlotHandle::invalid if p is not in this pool
+    std::uint32_t index_of(const void* p) const noexcept {
+        std::size_t slot;
+        const Segment* seg = locate_(p, slot);
+        return seg ? seg->first_index + static_cast<std::uint32_t>(slot) : SlotHandle::invalid;
+    }
 
-    // Thread-safe lock
-    SpinLock lock_;
-};
+    // 编号到地址，不检查代数与占用，供 pool_ptr 解引用 / Index to address without generation or occupancy checks, for pool_ptr
+    T* at_index(std::uint32_t index) noexcept {
+        std::size_t slot;
+        Segment* seg = segment_of_index_(index, slot);
+        if (!seg) return nullptr;
+        if (cold_tier_) warm_(*seg);
+        return reinterpret_cast<T*>(seg->data + slot * slot_size_);
+    }
 
-// ----------------------------
-// PooledObject 基类 / Base class for pooled objects
-// ----------------------------
-template <class Derived>
-struct PooledObject {
-    virtual ~PooledObject() = default;
-    virtual void reset() {}
+    // 按地址顺序遍历存活对象，只读取位图和对象本身
+    // Visit live objects in segment order; touches only the bitmap and the payload
+    template <class Fn>
+    void for_each(Fn&& fn) {
+        for (std::size_t i : seg_order_) for_each_in_segment_(segments_[i], fn);
+    }
 
-    // 用于极致性能场景的线程不安全创建方法 / Thread-unsafe creation method for extreme performance scenarios
-    static Derived* create(auto&&... args) {
-        return SegmentedObjectPool<Derived>::instance().allocate(std::forward<decltype(args)>(args)...);
+    // 只遍历某个段组或对象组 / Visit one segment set or object group only
+    template <class Fn>
+    void for_each(AllocHint set, Fn&& fn) {
+        if (set.set >= sets_.size() || (set.set >= max_hint_sets && !live_group_(set))) return;
+        for (std::size_t i : sets_[set.set].segs) for_each_in_segment_(segments_[i], fn);
     }
 
-    // 线程安全版本的创建方法 Thread-safe version of the create method
-    static Derived* atomic_create(auto&&... args) {
-        return SegmentedObjectPool<Derived>::instance().atomic_allocate(std::forward<decltype(args)>(args)...);
+    // 与 atomic_* 分配回收并发的一致快照遍历：访问遍历开始时存活、且访问时仍存活的对象。
+    // 开始时持锁记录各段存活槽位及其代数，之后每批 batch 个对象短暂持锁访问；
+    // 期间回收的对象被跳过，新分配的对象不被访问。fn 在锁内执行，不得调用本池的 atomic_* 接口。
+    // Snapshot iteration concurrent with atomic_* allocation and deallocation: visits objects that
+    // were live when the walk started and are still live when reached. Live slots and their
+    // generations are recorded under the lock up front, then visited holding the lock for one batch
+    // at a time; objects recycled meanwhile are skipped and new ones are not visited. fn runs under
+    // the lock and must not call this pool's atomic_* API.
+    template <class Fn>
+    void atomic_for_each_snapshot(Fn&& fn, std::size_t batch = 256) {
+        struct SnapSegment { std::size_t index; std::uint64_t serial; std::size_t begin, end; };
+        std::vector<SnapSegment> segs;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> slots;   // (槽位, 代数) / (slot, generation)
+        {
+            LockGuard g(lock_);
+            slots.reserve(live_count_);
+            for (std::size_t i : seg_order_) {
+                const Segment& seg = segments_[i];
+                const std::size_t begin = slots.size();
+                for (std::size_t w = 0, n = (seg.next_uninit + 63) / 64; w < n; ++w) {
+                    for (std::uint64_t bits = seg.used[w]; bits; bits &= bits - 1) {
+                        const std::size_t k = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                        slots.emplace_back(static_cast<std::uint32_t>(k), seg.gen[k]);
+                    }
+                }
+                if (slots.size() != begin) segs.push_back({i, seg.serial, begin, slots.size()});
+            }
+        }
+        for (const SnapSegment& snap : segs) {
+            for (std::size_t b = snap.begin; b < snap.end; b += batch) {
+                LockGuard g(lock_);
+                if (snap.index >= segments_.size()) break;
+                Segment& seg = segments_[snap.index];
+                if (!seg.data || seg.serial != snap.serial) break;   // 段已释放 / Segment released meanwhile
+                if (cold_tier_) warm_(seg);
+                for (std::size_t k = b, e = std::min(b + batch, snap.end); k < e; ++k) {
+                    const auto [slot, gen] = slots[k];
+                    if (seg.is_used(slot) && seg.gen[slot] == gen)
+                        fn(*reinterpret_cast<T*>(seg.data + slot * slot_size_));
+                }
+            }
+        }
     }
 
-    // 用于极致性能场景的线程不安全回收方法 / Thread-unsafe recycle method for extreme performance scenarios
-    inline void recycle() {
-        this->reset();
-        recycled_ = true;
-        SegmentedObjectPool<Derived>::instance().deallocate(static_cast<Derived*>(this));
+    // =============================================================
+    // 对象组：组拥有自己的段，整体释放 / Object groups: a group owns its segments and dies as a whole
+    // =============================================================
+
+    // 创建对象组，返回的提示用于 allocate。组编号不小于 max_hint_sets，释放后可复用，
+    // 但代数加一，旧提示既不能再分配也不能释放新组
+    // Create a group; pass the returned hint to allocate. Group ids start at max_hint_sets and are
+    // reused after release with a new generation, so an old hint can neither allocate into nor
+    // release the new group
+    AllocHint create_group() {
+        std::uint32_t id;
+        if (!free_groups_.empty()) {
+            id = free_groups_.back();
+            free_groups_.pop_back();
+        } else {
+            id = static_cast<std::uint32_t>(std::max<std::size_t>(sets_.size(), max_hint_sets));
+            sets_.resize(id + 1);
+        }
+        sets_[id].group = true;
+        return AllocHint{id, sets_[id].gen};
     }
 
-    // 线程安全版本的回收方法 Thread-safe version of the recycling method
-    inline void atomic_recycle() {
-        this->reset();
-        recycled_ = true;
-        SegmentedObjectPool<Derived>::instance().atomic_deallocate(static_cast<Derived*>(this));
+    // 析构组内所有对象并释放组的全部段，返回析构的对象数
+    // 内置提示和不是现存组的编号不做任何事，返回 0
+    // Destroy every object of the group and release all its segments; returns the number destroyed.
+    // Built-in hints and ids that are not live groups are left alone and return 0
+    std::size_t release_group(AllocHint group) noexcept {
+        if (!live_group_(group)) return 0;
+        SegmentSet& set = sets_[group.set];
+        std::size_t destroyed = 0;
+        for (std::size_t i : set.segs) {
+            Segment& seg = segments_[i];
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                for_each_in_segment_(seg, [](T& obj) { recycle_hook_(obj); obj.~T(); });
+            }
+            for (std::size_t w = 0, n = (seg.next_uninit + 63) / 64; w < n; ++w)
+                destroyed += static_cast<std::size_t>(std::popcount(seg.used[w]));
+            free_segment_(i);
+        }
+        const std::uint32_t gen = set.gen + 1;
+        set = SegmentSet{};
+        set.gen = gen;
+        live_count_ -= destroyed;
+        free_groups_.push_back(group.set);
+        return destroyed;
     }
 
-    inline bool is_recycled() const noexcept { return recycled_; }
-    inline void mark_in_use() noexcept { recycled_ = false; }
+    // =============================================================
+    // 按键重排：让地址顺序与键顺序一致 / Key-ordered relocation: make address order follow key order
+    // =============================================================
 
-private:
-    bool recycled_ = false;
+    // 增量重排任务。创建时记录段组内存活对象和它们的键，之后每次 step 最多处理 budget 个位置，
+    // 通过交换两个槽位中的对象完成移动，并对每个被移动的对象调用 on_relocate(from, to)。
+    // 任务存在期间不允许对该池分配或回收；被移动的槽位代数加一。
+    // Incremental reorder job. It snapshots the set's live objects and their keys; each step
+    // processes at most `budget` positions, moving objects by swapping two slots and calling
+    // on_relocate(from, to) for every object that moved. The pool must not allocate or
+    // deallocate while a job exists; the generation of every moved slot is bumped.
+    template <class Key>
+    class ReorderJob {
+    public:
+        using Relocate = std::function<void(T* from, T* to)>;
+
+        ReorderJob(ReorderJob&& o) noexcept
+        : pool_(std::exchange(o.pool_, nullptr)), slots_(std::move(o.slots_)), order_(std::move(o.order_)),
+          at_(std::move(o.at_)), where_(std::move(o.where_)), cursor_(o.cursor_), relocate_(std::move(o.relocate_)) {}
+        ReorderJob(const ReorderJob&) = delete;
+        ReorderJob& operator=(const ReorderJob&) = delete;
+        ReorderJob& operator=(ReorderJob&&) = delete;
+        ~ReorderJob() { if (pool_) --pool_->reorder_jobs_; }
+
+        // 处理至多 budget 个位置，完成时返回 true / Process up to `budget` positions; true when finished
+        bool step(std::size_t budget) {
+            for (; cursor_ < order_.size() && budget; ++cursor_, --budget) {
+                const std::size_t want = order_[cursor_];
+                if (at_[cursor_] == want) continue;
+                const std::size_t j = where_[want];
+                pool_->swap_slots_(slots_[cursor_], slots_[j]);
+                if (relocate_) {
+                    relocate_(slots_[j], slots_[cursor_]);
+                    relocate_(slots_[cursor_], slots_[j]);
+                }
+                std::swap(at_[cursor_], at_[j]);
+                where_[at_[cursor_]] = cursor_;
+                where_[at_[j]] = j;
+            }
+            return done();
+        }
+
+        // 在给定时间片内推进 / Advance within a time slice
+        bool step_for(std::chrono::nanoseconds slice, std::size_t batch = 256) {
+            const auto deadline = std::chrono::steady_clock::now() + slice;
+            while (!step(batch) && std::chrono::steady_clock::now() < deadline) {}
+            return done();
+        }
+
+        bool done() const noexcept { return cursor_ == order_.size(); }
+        std::size_t size() const noexcept { return order_.size(); }
+
+    private:
+        friend class SegmentedObjectPool;
+
+        template <class KeyFn>
+        ReorderJob(SegmentedObjectPool& pool, AllocHint set, KeyFn& key_fn, Relocate relocate)
+        : pool_(&pool), relocate_(std::move(relocate)) {
+            ++pool_->reorder_jobs_;
+            pool.for_each(set, [&](T& obj) { slots_.push_back(&obj); });
+            std::vector<std::pair<Key, std::size_t>> keyed;
+            keyed.reserve(slots_.size());
+            for (std::size_t i = 0; i < slots_.size(); ++i) keyed.emplace_back(key_fn(*slots_[i]), i);
+            std::stable_sort(keyed.begin(), keyed.end(),
+                [](auto const& a, auto const& b) { return a.first < b.first; });
+            order_.resize(slots_.size());
+            at_.resize(slots_.size());
+            where_.resize(slots_.size());
+            for (std::size_t i = 0; i < slots_.size(); ++i) {
+                order_[i] = keyed[i].second;
+                at_[i] = where_[i] = i;
+            }
+        }
+
+        SegmentedObjectPool* pool_;
+        std::vector<T*> slots_;              // 按地址排序的槽位 / Slots in address order
+        std::vector<std::size_t> order_;     // order_[i]：应放到 slots_[i] 的对象 / Object that belongs in slots_[i]
+        std::vector<std::size_t> at_;        // at_[i]：当前在 slots_[i] 的对象 / Object currently in slots_[i]
+        std::vector<std::size_t> where_;     // where_[k]：对象 k 当前所在位置 / Current position of object k
+        std::size_t cursor_ = 0;
+        Relocate relocate_;
+    };
+
+    // =============================================================
+    // 分配事务 / Allocation transactions
+    // =============================================================
+
+    // 事务内分配的对象以句柄栈记录；rollback 一次性回收它们，commit 使其永久保留，
+    // 析构时未提交则自动回滚。已在事务内被单独回收的对象回滚时跳过。
+    // Objects allocated through the transaction are logged as a stack of handles; rollback()
+    // releases them in one batch, commit() keeps them, and destruction without commit rolls back.
+    // Objects that were already deallocated inside the transaction are skipped on rollback.
+    class Transaction {
+    public:
+        explicit Transaction(SegmentedObjectPool& pool) : pool_(pool) {}
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+        ~Transaction() { rollback(); }
+
+        template <class... Args>
+        T* allocate(Args&&... args) {
+            T* obj = pool_.allocate(std::forward<Args>(args)...);
+            log_.push_back(pool_.handle_of(obj));
+            return obj;
+        }
+
+        template <class... Args>
+        T* atomic_allocate(Args&&... args) {
+            LockGuard g(pool_.lock_);
+            atomic_ = true;
+            T* obj = pool_.allocate(std::forward<Args>(args)...);
+            log_.push_back(pool_.handle_of(obj));
+            return obj;
+        }
+
+        void commit() noexcept { log_.clear(); }
+
+        // 逆序回收全部对象；用过 atomic_allocate 时只加一次锁 / Release everything in reverse; one lock if atomic_allocate was used
+        void rollback() noexcept {
+            if (log_.empty()) return;
+            if (atomic_) pool_.lock_.lock();
+            for (auto it = log_.rbegin(); it != log_.rend(); ++it)
+                if (T* p = pool_.resolve(*it)) pool_.recycle(p);
+            if (atomic_) pool_.lock_.unlock();
+            log_.clear();
+        }
+
+        std::size_t size() const noexcept { return log_.size(); }
+
+    private:
+        SegmentedObjectPool& pool_;
+        std::vector<SlotHandle> log_;
+        bool atomic_ = false;
+    };
+
+    Transaction begin_transaction() { return Transaction(*this); }
+
+    // =============================================================
+    // 增量检查点 / Incremental checkpoints
+    // =============================================================
+
+    // 开启页粒度脏页跟踪：分配与 touch 标记对象所在页，回收标记段的旁路表
+    // Enable page-granular dirty tracking: allocation and touch() mark the object's pages,
+    // deallocation marks the segment's side table
+    void enable_dirty_tracking() {
+        if (dirty_tracking_) return;
+        dirty_tracking_ = true;
+        for (auto& seg : segments_) if (seg.data) track_segment_(seg);
+    }
+
+    // 修改对象后调用，标记它覆盖的页 / Call after modifying an object; marks the pages it spans
+    void touch(const void* p) noexcept {
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (seg && cold_tier_) warm_(*seg);
+        if (seg && seg->dirty_pages) touch_pages_(*seg, slot);
+    }
+
+    // 写检查点：full 时写出全部页面作为基准，否则只写上次以来的脏页；写完清除脏标记。
+    // 页面按原始字节保存，跨进程恢复要求 T 可平凡复制（带虚表的对象只能在同一映像内恢复）。
+    // Write a checkpoint: every page for a base (full), otherwise only pages dirtied since the
+    // last one; dirty marks are cleared afterwards. Pages are raw bytes, so recovery in another
+    // process needs a trivially copyable T (objects with a vptr only restore within the same image).
+    bool write_checkpoint(std::ostream& out, bool full = false) {
+        if (!dirty_tracking_) enable_dirty_tracking();
+        warm_all_();
+        if (full) checkpoint_seq_ = 0;
+        const CheckpointHeader hdr{checkpoint_magic, full ? 1u : 0u, slot_size_, page_size_,
+                                   checkpoint_seq_, segments_.size()};
+        write_pod_(out, hdr);
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            const Segment& seg = segments_[i];
+            const CheckpointSegment rec{seg.capacity, seg.next_uninit, seg.set, seg.first_index,
+                                        (full || seg.meta_dirty) ? 1u : 0u};
+            write_pod_(out, rec);
+            if (!seg.data || !rec.has_meta) continue;
+            out.write(reinterpret_cast<const char*>(seg.used.get()), (seg.capacity + 63) / 64 * sizeof(std::uint64_t));
+            out.write(reinterpret_cast<const char*>(seg.gen.get()), seg.capacity * sizeof(std::uint32_t));
+        }
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            Segment& seg = segments_[i];
+            if (!seg.data) continue;
+            const std::size_t pages = seg.pages(slot_size_, page_size_);
+            for (std::size_t pg = 0; pg < pages; ++pg) {
+                if (!full && !((seg.dirty_pages[pg >> 6] >> (pg & 63)) & 1u)) continue;
+                const std::uint64_t where[2] = {i, pg};
+                write_pod_(out, where);
+                out.write(reinterpret_cast<const char*>(seg.data + pg * page_size_), page_size_);
+            }
+            std::fill_n(seg.dirty_pages.get(), (pages + 63) / 64, 0);
+            seg.meta_dirty = false;
+        }
+        const std::uint64_t end_mark[2] = {~std::uint64_t(0), 0};
+        write_pod_(out, end_mark);
+        ++checkpoint_seq_;
+        return static_cast<bool>(out);
+    }
+
+    // 应用基准或增量检查点；增量必须按写出顺序应用。
+    // 段记录先全部读入并校验，不合法时池保持原样并返回 false；页面部分中途出错时池已被部分覆盖，
+    // 此时清空池再返回 false，应从基准重新恢复
+    // Apply a base or delta checkpoint; deltas must follow in order.
+    // Segment records are read and checked in full first; if any is invalid the pool is left as it
+    // was and false is returned. Once pages are being applied the pool is partly overwritten, so an
+    // error there clears the pool before returning false; restore again from a base
+    bool restore_checkpoint(std::istream& in) {
+        CheckpointHeader hdr{};
+        if (!read_pod_(in, hdr) || hdr.magic != checkpoint_magic || hdr.slot_size != slot_size_ ||
+            hdr.page_size != page_size_)
+            return false;
+        if (!hdr.full && hdr.seq != checkpoint_seq_) return false;
+
+        // 记录数只信任流里真正读到的部分 / Trust the record count only as far as records are actually read
+        std::vector<StagedSegment> staged;
+        for (std::uint64_t i = 0; i < hdr.segments; ++i) {
+            StagedSegment st{};
+            if (!read_pod_(in, st.rec) || !stage_segment_(in, i, hdr.full != 0, st)) return false;
+            staged.push_back(std::move(st));
+        }
+
+        if (hdr.full) clear();
+        // 冷段先解压：增量只覆盖部分页面，留着压缩内容会在下次访问时盖掉恢复的页面
+        // Decompress cold segments first: a delta covers only some pages, and stale compressed
+        // contents would overwrite the restored pages on the next access
+        warm_all_();
+        dirty_tracking_ = true;
+        try {
+            apply_segments_(staged);
+        } catch (...) {
+            clear();
+            throw;
+        }
+        for (;;) {
+            std::uint64_t where[2];
+            if (!read_pod_(in, where)) { clear(); return false; }
+            if (where[0] == ~std::uint64_t(0)) break;
+            if (where[0] >= segments_.size() || !segments_[where[0]].data ||
+                where[1] >= segments_[where[0]].pages(slot_size_, page_size_)) {
+                clear();
+                return false;
+            }
+            in.read(reinterpret_cast<char*>(segments_[where[0]].data + where[1] * page_size_), page_size_);
+        }
+        if (!in) { clear(); return false; }
+        checkpoint_seq_ = hdr.seq + 1;
+        rebuild_after_restore_();
+        return true;
+    }
+
+    // =============================================================
+    // 逐槽变更跟踪 / Per-slot change tracking
+    // =============================================================
+
+    // 开启逐槽变更位图，用于只处理上次以来改过的对象
+    // Enable the per-slot change bitmap, so a pass only visits objects modified since the last one
+    void enable_change_tracking() {
+        if (change_tracking_) return;
+        change_tracking_ = true;
+        for (auto& seg : segments_) if (seg.data) track_segment_(seg);
+    }
+
+    // 标记对象已修改；未开启跟踪时什么也不做 / Mark an object as modified; a no-op unless tracking is on
+    void mark_dirty(const void* p) noexcept {
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (!seg || !seg->changed) return;
+        seg->changed[slot >> 6] |= std::uint64_t(1) << (slot & 63);
+        seg->any_changed = true;
+    }
+
+    // 通过句柄标记，句柄失效时忽略 / Mark through a handle; stale handles are ignored
+    void mark_dirty(SlotHandle h) noexcept {
+        std::size_t slot;
+        Segment* seg = segment_of_index_(h.index, slot);
+        if (!seg || !seg->changed || !seg->is_used(slot) || seg->gen[slot] != h.gen) return;
+        seg->changed[slot >> 6] |= std::uint64_t(1) << (slot & 63);
+        seg->any_changed = true;
+    }
+
+    // 按地址顺序访问被标记的存活对象并清除标记；跳过没有标记的段，逐字扫描位图
+    // Visit marked live objects in address order and clear the marks; clean segments are
+    // skipped and bitmaps are scanned a word at a time
+    template <class Fn>
+    void for_each_dirty_and_clear(Fn&& fn) {
+        for (std::size_t i : seg_order_) {
+            Segment& seg = segments_[i];
+            if (!seg.any_changed) continue;
+            seg.any_changed = false;
+            if (cold_tier_) warm_(seg);
+            const std::size_t words = (seg.next_uninit + 63) / 64;
+            for (std::size_t w = 0; w < words; ++w) {
+                std::uint64_t bits = seg.changed[w] & seg.used[w];
+                seg.changed[w] = 0;
+                while (bits) {
+                    std::size_t k = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                    bits &= bits - 1;
+                    fn(*reinterpret_cast<T*>(seg.data + k * slot_size_));
+                }
+            }
+        }
+    }
+
+    // =============================================================
+    // 顺序锁读取 / Seqlock-protected reads
+    // =============================================================
+    // 单个写线程通过 write_guard 修改对象，其他线程用 SeqRef::read 无锁读取并在冲突时重试。
+    // 序号字的高 32 位是槽位代数，读取期间对象被回收时 read 返回 false。
+    // SeqRef 应在写线程（或持锁时）取得再交给读线程；读线程存在期间不要释放段（trim、release_group、clear）。
+    // A single writer mutates objects under write_guard; other threads read lock-free through
+    // SeqRef::read and retry on conflict. The high 32 bits of the sequence word hold the slot
+    // generation, so read() returns false once the object is recycled. Take SeqRefs on the writer
+    // side (or under the lock) and hand them to readers; do not release segments (trim,
+    // release_group, clear) while readers hold them.
+
+    // 写保护：构造时序号变为奇数，析构时变回偶数 / Write guard: the sequence is odd while it lives
+    class WriteGuard {
+    public:
+        explicit WriteGuard(std::atomic<std::uint64_t>* word) noexcept : word_(word) {
+            if (!word_) return;
+            std::uint64_t s = word_->load(std::memory_order_relaxed);
+            word_->store(next_seq_(s), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        WriteGuard(const WriteGuard&) = delete;
+        WriteGuard& operator=(const WriteGuard&) = delete;
+        ~WriteGuard() {
+            if (word_) word_->store(next_seq_(word_->load(std::memory_order_relaxed)), std::memory_order_release);
+        }
+
+    private:
+        std::atomic<std::uint64_t>* word_;
+    };
+
+    // 读端引用：对象地址、序号字和取得时的代数 / Reader-side reference: object, sequence word and generation when taken
+    class SeqRef {
+    public:
+        SeqRef() = default;
+        SeqRef(const T* obj, const std::atomic<std::uint64_t>* word, std::uint32_t gen) noexcept
+        : obj_(obj), word_(word), gen_(gen) {}
+
+        explicit operator bool() const noexcept { return obj_ != nullptr; }
+
+        // fn(const T&) 可能被调用多次，应只把字段拷出；对象已回收时返回 false
+        // fn(const T&) may run several times and should only copy fields out; false if the object was recycled
+        template <class Fn>
+        bool read(Fn&& fn) const {
+            if (!word_) return false;
+            for (;;) {
+                const std::uint64_t s1 = word_->load(std::memory_order_acquire);
+                if (static_cast<std::uint32_t>(s1 >> 32) != gen_) return false;
+                if (s1 & 1u) { spin_pause_(); continue; }
+                fn(*obj_);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (word_->load(std::memory_order_relaxed) == s1) return true;
+            }
+        }
+
+    private:
+        const T* obj_ = nullptr;
+        const std::atomic<std::uint64_t>* word_ = nullptr;
+        std::uint32_t gen_ = 0;
+    };
+
+    // 开启逐槽序号；须在读线程开始前调用 / Enable per-slot sequence words; call before readers start
+    void enable_seqlock() {
+        if (seqlock_) return;
+        seqlock_ = true;
+        for (auto& seg : segments_) if (seg.data) track_segment_(seg);
+    }
+
+    // 写保护，未开启顺序锁或 p 不属于本池时不做任何事 / Write guard; inert without enable_seqlock() or for foreign pointers
+    WriteGuard write_guard(const T* p) noexcept {
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (seg && cold_tier_) warm_(*seg);   // 写入前解压 / Decompress before the write lands
+        return WriteGuard(seg && seg->seq ? &seg->seq[slot] : nullptr);
+    }
+
+    SeqRef seq_ref(SlotHandle h) noexcept {
+        std::size_t slot;
+        Segment* seg = segment_of_index_(h.index, slot);
+        if (!seg || !seg->seq || !seg->is_used(slot) || seg->gen[slot] != h.gen) return {};
+        if (cold_tier_) warm_(*seg);
+        return SeqRef(reinterpret_cast<const T*>(seg->data + slot * slot_size_), &seg->seq[slot], h.gen);
+    }
+
+    SeqRef seq_ref(const T* p) noexcept { return seq_ref(handle_of(p)); }
+
+    // =============================================================
+    // 标记-清除回收 / Mark-sweep collection
+    // =============================================================
+    // 对象通过 trace(visitor) 报告自己引用的同池对象（T*、const T* 或 pool_ptr），collect() 从根集合出发
+    // 标记可达对象，再按段逐字比较占用位图与标记位图，批量析构并回收不可达对象。没有 trace 的类型视为叶子。
+    // 析构函数不得回收本池的其他对象；回收顺序为地址顺序。仍在信号栈上的保留对象视为根。
+    // Objects report the same-pool objects they reference (T*, const T* or pool_ptr) through
+    // trace(visitor); collect() marks everything reachable from the root set, then compares each
+    // segment's occupancy and mark bitmaps a word at a time, destroying and recycling unreachable
+    // objects in bulk. Types without trace are leaves. Destructors must not deallocate other objects
+    // of this pool; objects are destroyed in address order. Reserve objects still on the signal stack count as roots.
+
+    class TraceVisitor {
+    public:
+        void operator()(const T* p) {
+            std::size_t slot;
+            const Segment* seg = p ? pool_.locate_(p, slot) : nullptr;
+            if (seg) mark_(*seg, slot);
+        }
+
+        template <class U> requires std::is_same_v<std::remove_const_t<U>, T>
+        void operator()(pool_ptr<U> p) {
+            std::size_t slot;
+            const Segment* seg = pool_.segment_of_index_(p.index(), slot);
+            if (seg) mark_(*seg, slot);
+        }
+
+    private:
+        friend class SegmentedObjectPool;
+        explicit TraceVisitor(SegmentedObjectPool& pool) : pool_(pool) {}
+
+        void mark_(const Segment& seg, std::size_t slot) {
+            if (!seg.is_used(slot)) return;
+            const std::size_t index = static_cast<std::size_t>(&seg - pool_.segments_.data());
+            std::uint64_t& word = marks_[offsets_[index] + (slot >> 6)];
+            const std::uint64_t bit = std::uint64_t(1) << (slot & 63);
+            if (word & bit) return;
+            word |= bit;
+            if (pool_.cold_tier_) pool_.warm_(pool_.segments_[index]);   // trace 读取对象内容 / trace reads the object
+
+            stack_.push_back(reinterpret_cast<T*>(seg.data + slot * pool_.slot_size_));
+        }
+
+        SegmentedObjectPool& pool_;
+        std::vector<std::size_t> offsets_;    // 各段标记位图在 marks_ 中的起点 / Start of each segment's mark bitmap in marks_
+        std::vector<std::uint64_t> marks_;
+        std::vector<T*> stack_;               // 待追踪对象，避免递归 / Objects left to trace, instead of recursion
+    };
+
+    // 根集合以句柄保存，根对象被手动回收后自动失效 / Roots are kept as handles and lapse once the object is recycled
+    void add_root(const T* p) {
+        if (SlotHandle h = handle_of(p)) roots_.push_back(h);
+    }
+
+    void remove_root(const T* p) noexcept {
+        const SlotHandle h = handle_of(p);
+        if (auto it = std::find(roots_.begin(), roots_.end(), h); it != roots_.end()) {
+            *it = roots_.back();
+            roots_.pop_back();
+        }
+    }
+
+    std::size_t root_count() const noexcept { return roots_.size(); }
+
+    // 标记并清除，返回回收的对象数；在可控的空闲时刻调用 / Mark and sweep; returns objects reclaimed. Run at a quiet time
+    std::size_t collect() {
+        assert(reorder_jobs_ == 0 && "collect() while a ReorderJob is active");
+        TraceVisitor v(*this);
+        v.offsets_.resize(segments_.size());
+        std::size_t words = 0;
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            v.offsets_[i] = words;
+            if (segments_[i].data) words += (segments_[i].capacity + 63) / 64;
+        }
+        v.marks_.assign(words, 0);
+
+        std::erase_if(roots_, [this](SlotHandle h) { return !resolve(h); });
+        for (SlotHandle h : roots_) v(resolve(h));
+        // 只有仍在信号栈上的保留对象是根，已取出的对象与普通对象一样 / Only reserve objects still on the signal stack are roots
+        if (sig_)
+            for (std::uint32_t i = static_cast<std::uint32_t>(sig_->full.load() & 0xFFFFFFFFu); i != SlotHandle::invalid;
+                 i = sig_->next[i].load()) v(sig_->objs[i]);
+        while (!v.stack_.empty()) {
+            T* obj = v.stack_.back();
+            v.stack_.pop_back();
+            if constexpr (requires(T& t) { t.trace(v); }) obj->trace(v);
+        }
+
+        std::size_t reclaimed = 0;
+        for (std::size_t i : seg_order_) {
+            Segment& seg = segments_[i];
+            const std::uint64_t* mark = v.marks_.data() + v.offsets_[i];
+            const std::size_t n = (seg.next_uninit + 63) / 64;
+            for (std::size_t w = 0; w < n; ++w) {
+                std::uint64_t dead = seg.used[w] & ~mark[w];
+                if (!dead) continue;
+                if (cold_tier_) warm_(seg);
+                while (dead) {
+                    std::size_t k = w * 64 + static_cast<std::size_t>(std::countr_zero(dead));
+                    dead &= dead - 1;
+                    T* p = reinterpret_cast<T*>(seg.data + k * slot_size_);
+                    recycle_hook_(*p);
+                    p->~T();
+                    release_in_(seg, k, p);
+                    ++reclaimed;
+                }
+            }
+        }
+        live_count_ -= reclaimed;
+        return reclaimed;
+    }
+
+    std::size_t atomic_collect() {
+        LockGuard g(lock_);
+        return collect();
+    }
+
+#if defined(__linux__)
+    // =============================================================
+    // 冷段压缩 / Cold-segment compression
+    // =============================================================
+    // 连续 idle 时间未被访问的堆段压缩进紧凑缓冲区并释放页面（MADV_DONTNEED，地址不变），
+    // 下次经 resolve、遍历、分配或回收访问时透明解压。段内对象只应通过句柄或池的接口访问：
+    // 跨越 compress_cold 持有的裸指针可能指向已释放的页面。
+    // Heap segments not accessed for `idle` are compressed into a compact buffer and their pages
+    // released (MADV_DONTNEED; addresses stay), then decompressed transparently on the next access
+    // through resolve, iteration, allocation or deallocation. Reach objects through handles or the
+    // pool's API only: a raw pointer held across compress_cold may point at released pages.
+
+    void enable_cold_tier(std::chrono::nanoseconds idle) noexcept {
+        cold_tier_ = true;
+        cold_idle_ = static_cast<std::uint64_t>(idle.count());
+    }
+
+    // 周期性调用：记录本轮访问过的段，压缩空闲够久的段，返回本次压缩的段数
+    // Call periodically: notes which segments were accessed this round and compresses those idle
+    // long enough; returns how many were compressed
+    std::size_t compress_cold() {
+        if (!cold_tier_) return 0;
+        const std::uint64_t now = now_ns_();
+        std::size_t compressed = 0;
+        std::vector<std::byte> buf;
+        for (auto& seg : segments_) {
+            if (!seg.data || seg.packed || seg.mapping != map_heap) continue;
+            if (seg.touched == cold_epoch_ || seg.idle_since == 0) { seg.idle_since = now; continue; }
+            if (now - seg.idle_since < cold_idle_) continue;
+            const std::size_t bytes = seg.capacity * slot_size_;
+            buf.clear();
+            detail::lz_compress(seg.data, bytes, buf);
+            if (buf.size() > bytes / 10 * 9) { seg.idle_since = now; continue; }   // 压缩不划算 / Not worth it
+            seg.packed = std::make_unique<std::byte[]>(buf.size());
+            std::memcpy(seg.packed.get(), buf.data(), buf.size());
+            seg.packed_bytes = buf.size();
+            ::madvise(seg.data, bytes / page_size_ * page_size_, MADV_DONTNEED);
+            ++compressed;
+        }
+        ++cold_epoch_;
+        return compressed;
+    }
+
+    std::size_t atomic_compress_cold() {
+        LockGuard g(lock_);
+        return compress_cold();
+    }
+
+    // 冷段数与压缩后的字节数 / Number of cold segments and their compressed bytes
+    std::size_t cold_segments() const noexcept {
+        std::size_t n = 0;
+        for (auto const& seg : segments_) n += seg.packed != nullptr;
+        return n;
+    }
+
+    std::size_t cold_bytes() const noexcept {
+        std::size_t n = 0;
+        for (auto const& seg : segments_) if (seg.packed) n += seg.packed_bytes;
+        return n;
+    }
+
+    // =============================================================
+    // 文件后备 / File-backed pools
+    // =============================================================
+    // 段是交换文件的 MAP_SHARED 切片，对象由内核按需换入换出，池可以大于物理内存。
+    // 交换文件在给定目录中以 O_TMPFILE 创建，没有名字，池销毁时随之消失；这不是持久化，
+    // 需要跨进程保留数据时使用检查点。
+    // Segments are MAP_SHARED slices of a swap file, paged in and out by the kernel, so the pool
+    // can exceed RAM. The swap file is created unnamed (O_TMPFILE) in the given directory and
+    // vanishes with the pool; this is not persistence, use checkpoints to keep data across runs.
+
+    // 在空池上调用，改为文件后备；dir 决定交换文件所在的文件系统
+    // Call on an empty pool to switch it to file backing; dir picks the filesystem the swap file lives on
+    bool open_swap_file(const char* dir) {
+        static_assert(std::is_trivially_copyable_v<T>, "file-backed pools hold trivially copyable objects only");
+        assert(segment_count_ == 0 && "open_swap_file on a pool that already has segments");
+        if (segment_count_ != 0) return false;
+        const int fd = ::open(dir, O_RDWR | O_TMPFILE | O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+        memfile_ = std::make_shared<detail::MemFile>(fd);
+        backing_ = PoolBacking::file;
+        return true;
+    }
+
+    // 遍历前调用：按顺序预读、读后尽快回收页面 / Call before iterating: read ahead in order and drop pages behind
+    void advise_sequential(bool on = true) noexcept {
+        for (auto const& seg : segments_)
+            if (seg.data) ::madvise(seg.data, seg.pages(slot_size_, page_size_) * page_size_, on ? MADV_SEQUENTIAL : MADV_NORMAL);
+    }
+
+    // 预取从 first 开始、地址连续的 count 个槽位 / Prefetch count slots in address order starting at first
+    void will_need(const T* first, std::size_t count) noexcept {
+        std::size_t slot;
+        const Segment* seg = locate_(first, slot);
+        if (!seg || count == 0) return;
+        const std::size_t lo = slot * slot_size_ / page_size_ * page_size_;
+        const std::size_t hi = std::min(seg->capacity, slot + count) * slot_size_;
+        ::madvise(seg->data + lo, hi - lo, MADV_WILLNEED);
+    }
+
+    // =============================================================
+    // 写时复制 fork / Copy-on-write fork (PoolBacking::memfd)
+    // =============================================================
+
+    // 以 MAP_PRIVATE 重新映射同一批段，只有被修改的页面才会复制；旁路表按字节复制，
+    // 空闲栈由位图重建。句柄在 fork 中保持有效，裸指针不会。fork 新增的段来自堆。
+    // fork 存续期间父池对某页的修改，在 fork 尚未写过该页时对 fork 可见，
+    // 所以 what-if 计算期间应保持父池静止。
+    // Map the same segments MAP_PRIVATE so only pages that get written are copied; side tables
+    // are copied and free stacks rebuilt from the bitmaps. Handles stay valid in the fork, raw
+    // pointers do not. Segments the fork adds come from the heap. While a fork exists, parent
+    // writes to a page remain visible to the fork until the fork writes that page itself, so
+    // keep the parent quiescent during a what-if run.
+    // 堆上的池返回 nullptr / Returns nullptr for heap-backed pools
+    // 非 const：冷段先解压，fork 才能映射到内容 / Not const: cold segments are decompressed first so the fork maps their contents
+    // 对象按页面共享，不经复制构造，T 须可平凡复制 / Objects are shared as raw pages without copy construction, so T must be trivially copyable
+    std::unique_ptr<SegmentedObjectPool> fork() {
+        static_assert(std::is_trivially_copyable_v<T>, "fork shares objects as raw pages; T must be trivially copyable");
+        if (backing_ == PoolBacking::heap) return nullptr;
+        warm_all_();
+        auto child = std::make_unique<SegmentedObjectPool>(0, growth_factor_);
+        child->pages_per_segment_base_ = pages_per_segment_base_;
+        child->dir_unit_ = dir_unit_;
+        child->memfile_ = memfile_;
+        child->segments_.resize(segments_.size());
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            const Segment& src = segments_[i];
+            if (!src.data) continue;
+            const std::size_t bytes = src.capacity * slot_size_;
+            void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, memfile_->fd,
+                             static_cast<off_t>(src.file_offset));
+            if (p == MAP_FAILED) throw std::bad_alloc();
+            PoolRegistry::instance().charge(child->registry_, bytes, true);
+            Segment& dst = child->segments_[i];
+            dst = Segment(static_cast<std::byte*>(p), src.capacity, src.set);
+            dst.next_uninit = src.next_uninit;
+            dst.first_index = src.first_index;
+            dst.mapping = map_private;
+            dst.file_offset = src.file_offset;
+            dst.serial = src.serial;
+            std::copy_n(src.used.get(), (src.capacity + 63) / 64, dst.used.get());
+            std::copy_n(src.gen.get(), src.capacity, dst.gen.get());
+        }
+        child->vacant_ = vacant_;
+        child->dir_ = dir_;
+        child->dir_gen_ = dir_gen_;
+        child->free_groups_ = free_groups_;
+        child->segment_count_ = segment_count_;
+        child->segment_serial_ = segment_serial_;
+        child->live_count_ = live_count_;
+        child->sets_.resize(sets_.size());
+        for (std::size_t s = 0; s < sets_.size(); ++s) {
+            child->sets_[s].current = sets_[s].current;
+            child->sets_[s].next_pages_hint = sets_[s].next_pages_hint;
+            child->sets_[s].group = sets_[s].group;
+            child->sets_[s].gen = sets_[s].gen;
+        }
+        child->rebuild_layout_();
+        return child;
+    }
+#endif
+
+    // 创建重排任务 / Start a reorder job for one segment set
+    template <class KeyFn>
+    auto reorder(KeyFn key_fn, std::function<void(T*, T*)> on_relocate = {}, AllocHint set = hint_default) {
+        static_assert(std::is_move_constructible_v<T>, "reorder relocates objects by move construction");
+        using Key = std::decay_t<std::invoke_result_t<KeyFn&, const T&>>;
+        return ReorderJob<Key>(*this, set, key_fn, std::move(on_relocate));
+    }
+
+    // =============================================================
+    // 🔒 线程安全 API（池内部同步）
+    // Thread-safe API (internal synchronization within the pool)
+    // =============================================================
+    template <class... Args>
+    T* atomic_allocate(Args&&... args) {
+        LockGuard g(lock_);
+        return allocate(std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    T* atomic_allocate_near(const T* hint, Args&&... args) {
+        LockGuard g(lock_);
+        return allocate_near(hint, std::forward<Args>(args)...);
+    }
+
+    void atomic_deallocate(T* p) noexcept {
+        if (!p) return;
+        LockGuard g(lock_);
+        deallocate(p);
+    }
+
+    void* atomic_allocate_raw() {
+        LockGuard g(lock_);
+        return allocate_raw();
+    }
+
+    void atomic_deallocate_raw(void* p) noexcept {
+        if (!p) return;
+        LockGuard g(lock_);
+        deallocate_raw(p);
+    }
+
+    bool atomic_contains(const void* p) noexcept {
+        LockGuard g(lock_);
+        return contains(p);
+    }
+
+    // 冷段解压改动池的状态，多线程解析句柄走这里 / Warming a cold segment mutates the pool; resolve from several threads through here
+    T* atomic_resolve(SlotHandle h) noexcept {
+        LockGuard g(lock_);
+        return resolve(h);
+    }
+
+    void atomic_clear() noexcept {
+        LockGuard g(lock_);
+        clear();
+    }
+
+    AllocHint atomic_create_group() {
+        LockGuard g(lock_);
+        return create_group();
+    }
+
+    std::size_t atomic_release_group(AllocHint group) noexcept {
+        LockGuard g(lock_);
+        return release_group(group);
+    }
+
+    std::size_t atomic_trim() noexcept {
+        LockGuard g(lock_);
+        return trim();
+    }
+
+    // 清空池子 / Clear all memory
+    void clear() noexcept {
+        for (auto& seg : segments_) {
+            if (seg.data) {
+                retire_indices_(seg);
+                release_memory_(seg);
+            }
+            seg.data = nullptr;
+        }
+        segments_.clear();
+        seg_order_.clear();
+        page_map_.reset();
+        vacant_.clear();
+        dir_.clear();
+        for (auto& set : sets_) {
+            const bool group = set.group;   // 组在清空后仍可使用 / Groups stay usable after a clear
+            const std::uint32_t gen = set.gen;
+            set = SegmentSet{};
+            set.group = group;
+            set.gen = gen;
+        }
+        live_count_ = 0;
+        segment_count_ = 0;
+        if (sig_) {
+            // 保留对象随段一起释放，位置全部等待补充 / Reserved objects went with the segments; every position awaits a refill
+            sig_->full = sig_empty;
+            sig_->empty = sig_empty;
+            for (std::size_t i = 0; i < sig_->capacity; ++i) sig_push_(sig_->empty, static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // 释放没有存活对象的段，返回释放的段数 / Release segments with no live objects; returns how many
+    std::size_t trim() noexcept {
+        std::size_t released = 0;
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            Segment& seg = segments_[i];
+            if (!seg.data || !seg.empty()) continue;
+            SegmentSet& set = sets_[seg.set];
+            std::erase_if(set.free, [i](const FreeSlot& f) { return f.seg == i; });
+            if (set.current == i) set.current = npos;
+            std::erase(set.segs, i);
+            free_segment_(i);
+            ++released;
+        }
+        if (released)
+            for (auto& set : sets_) set.free.shrink_to_fit();
+        return released;
+    }
+
+    // =============================================================
+    // 实时模式 / Real-time mode
+    // =============================================================
+    // 预热阶段 reserve + prefault 锁定内存，之后 freeze：分配路径不再增长段、不再扩容空闲栈，
+    // 不做任何系统调用；耗尽时调用 on_exhausted（可选）并返回 nullptr。
+    // Warm up with reserve + prefault to lock the memory, then freeze: the allocation path no
+    // longer adds segments or grows free stacks and makes no system calls; when exhausted it calls
+    // on_exhausted (if set) and returns nullptr.
+
+    // 保证段组至少有 n 个可用槽位，返回可用槽位数 / Make at least n slots available in a set; returns how many are
+    std::size_t reserve(std::size_t n, AllocHint hint = hint_default) {
+        if (!open_set_(hint)) return 0;
+        SegmentSet& set = sets_[hint.set];
+        auto available = [&] {
+            std::size_t a = set.free.size();
+            if (set.current != npos) a += segments_[set.current].capacity - segments_[set.current].next_uninit;
+            return a;
+        };
+        while (available() < n) {
+            // 当前段剩余的未切分槽位先放进空闲栈，否则换段后会被跳过
+            // Spill the current segment's uncarved slots into the free stack first, or switching segments would skip them
+            if (set.current != npos) {
+                Segment& cur = segments_[set.current];
+                for (std::size_t k = cur.capacity; k-- > cur.next_uninit;)
+                    set.free.push_back(free_slot_(set.current, k));
+                cur.next_uninit = cur.capacity;
+            }
+            set.current = add_segment_(hint.set);
+        }
+        return available();
+    }
+
+    // 以可写方式调入并锁定全部段的页面，不改变已有对象；之后新增的段也会锁定。
+    // 锁定失败（如 RLIMIT_MEMLOCK）时返回 false
+    // Fault in every segment's pages for writing without changing live objects, and lock them;
+    // segments added later are locked too. False if locking failed (e.g. RLIMIT_MEMLOCK)
+    bool prefault() {
+        warm_all_();
+        locked_ = true;
+        bool ok = true;
+        for (auto& seg : segments_) {
+            if (!seg.data) continue;
+            const std::size_t bytes = seg.capacity * slot_size_;
+#if defined(MADV_POPULATE_WRITE)
+            const bool populated = ::madvise(seg.data, bytes / page_size_ * page_size_, MADV_POPULATE_WRITE) == 0;
+#else
+            const bool populated = false;
+#endif
+            // 旧内核上原值写回每页一个字节 / On older kernels write one byte per page back with its own value
+            if (!populated) {
+                auto* bytes_v = reinterpret_cast<volatile std::byte*>(seg.data);
+                for (std::size_t off = 0; off < bytes; off += page_size_) bytes_v[off] = bytes_v[off];
+            }
+            ok = lock_pages_(seg.data, bytes) && ok;
+        }
+        return ok;
+    }
+
+    // 禁止增长；空闲栈预留到所属段组的总容量，回收时不再重新分配
+    // Forbid growth; free stacks are reserved to their set's full capacity so deallocation never reallocates
+    void freeze(std::function<void()> on_exhausted = {}) {
+        for (auto& set : sets_) {
+            std::size_t cap = 0;
+            for (std::size_t i : set.segs) cap += segments_[i].capacity;
+            set.free.reserve(cap);
+        }
+        on_exhausted_ = std::move(on_exhausted);
+        frozen_ = true;
+    }
+
+    void thaw() noexcept { frozen_ = false; }
+    bool frozen() const noexcept { return frozen_; }
+
+    // =============================================================
+    // 信号安全分配 / Async-signal-safe allocation
+    // =============================================================
+    // 预先构造的对象放在无锁栈（带标记的下标，防 ABA）中，signal_allocate 只做一次 CAS 出栈：
+    // 不加锁、不增长、不碰堆，可在信号处理函数里调用。取出的对象是普通的存活对象，
+    // 之后在信号上下文之外照常 deallocate；refill_signal_reserve 在信号上下文之外补满。
+    // Preconstructed objects sit in a lock-free stack of tagged indices (ABA-safe); signal_allocate
+    // pops with a single CAS, taking no lock, never growing and never touching the heap, so it may
+    // be called from a signal handler. Objects handed out are ordinary live objects, deallocated
+    // normally outside signal context; refill_signal_reserve tops the stack up outside it as well.
+
+    // 设定保留容量并构造对象；须在安装信号处理函数之前调用一次
+    // Set the reserve capacity and construct the objects; call once before installing handlers
+    template <class... Args>
+    std::size_t reserve_for_signals(std::size_t capacity, const Args&... args) {
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "signal reserve needs lock-free 64-bit atomics");
+        assert(!sig_ && "reserve_for_signals called twice");
+        sig_ = std::make_unique<SignalReserve>();
+        sig_->capacity = capacity;
+        sig_->objs = std::make_unique<T*[]>(capacity);
+        sig_->next = std::make_unique<std::atomic<std::uint32_t>[]>(capacity);
+        for (std::size_t i = 0; i < capacity; ++i) sig_push_(sig_->empty, static_cast<std::uint32_t>(i));
+        return refill_signal_reserve(args...);
+    }
+
+    // 补满保留对象，返回当前可用数 / Top the reserve up; returns how many are available
+    template <class... Args>
+    std::size_t refill_signal_reserve(const Args&... args) {
+        if (!sig_) return 0;
+        LockGuard g(lock_);
+        for (std::uint32_t i; (i = sig_pop_(sig_->empty)) != SlotHandle::invalid;) {
+            T* obj = allocate(args...);
+            if (!obj) { sig_push_(sig_->empty, i); break; }
+            sig_->objs[i] = obj;
+            sig_push_(sig_->full, i);
+        }
+        std::size_t n = 0;
+        for (std::uint32_t i = static_cast<std::uint32_t>(sig_->full.load() & 0xFFFFFFFFu); i != SlotHandle::invalid;
+             i = sig_->next[i].load()) ++n;
+        return n;
+    }
+
+    // 信号安全：取一个预先构造的对象，保留耗尽时返回 nullptr / Async-signal-safe: take a preconstructed object; nullptr when the reserve is empty
+    T* signal_allocate() noexcept {
+        if (!sig_) return nullptr;
+        const std::uint32_t i = sig_pop_(sig_->full);
+        if (i == SlotHandle::invalid) return nullptr;
+        T* obj = sig_->objs[i];
+        sig_push_(sig_->empty, i);
+        return obj;
+    }
+
+    // =============================================================
+    // 统计与寿命采样 / Statistics and lifetime sampling
+    // =============================================================
+
+    // 每 every 次分配采样一次分配时刻；回收时记入寿命直方图，stats() 给出存活对象的年龄直方图
+    // Sample the allocation time of one in every `every` allocations; deallocation records the
+    // lifetime, and stats() reports the age histogram of live sampled objects
+    void enable_lifetime_sampling(std::uint32_t every = 64) {
+        if (every == 0) every = 1;
+        sample_countdown_ = every;
+        const bool first = sample_every_ == 0;
+        sample_every_ = every;
+        if (first) for (auto& seg : segments_) if (seg.data) track_segment_(seg);
+    }
+
+    PoolStats stats() const {
+        PoolStats st;
+        st.live = live_count_;
+        st.segments = segment_count_;
+        st.capacity = capacity_total();
+        st.slot_size = slot_size_;
+        st.bytes = st.capacity * slot_size_;
+        st.sample_every = sample_every_;
+        st.lifetime_ns = lifetime_hist_;
+        if (!sample_every_) return st;
+        const std::uint64_t now = now_ns_();
+        for (auto const& seg : segments_) {
+            if (!seg.born) continue;
+            for (std::size_t i = 0; i < seg.next_uninit; ++i)
+                if (seg.born[i] && seg.is_used(i)) ++st.age_ns[age_bucket_(now - seg.born[i])];
+        }
+        return st;
+    }
+
+    PoolStats atomic_stats() {
+        LockGuard g(lock_);
+        return stats();
+    }
+
+    std::size_t live() const noexcept { return live_count_; }
+    std::size_t segments() const noexcept { return segment_count_; }
+    std::size_t capacity_total() const noexcept {
+        std::size_t c = 0; for (auto const& s : segments_) c += s.capacity; return c; }
+    std::size_t slot_size() const noexcept { return slot_size_; }
+    // 每个槽位地址保证的对齐 / Alignment guaranteed for every slot address
+    std::size_t slot_alignment() const noexcept { return std::min(seg_align_, detail::low_bit(slot_size_)); }
+
+private:
+    
+    // 分配和回收操作的具体实现
+    // The specific implementation of allocation and recycling operations
+
+    template <class... Args>
+    T* construct_(void* slot, Args&&... args) {
+        assert(reorder_jobs_ == 0 && "allocation while a ReorderJob is active");
+        if (!slot) return nullptr;   // 冻结后耗尽 / Exhausted after freeze()
+        T* obj;
+        try {
+            obj = ::new (slot) T(std::forward<Args>(args)...);
+        } catch (...) {
+            release_slot_(static_cast<T*>(slot));   // 构造失败，槽位放回空闲栈 / Constructor threw; the slot goes back to the free stack
+            throw;
+        }
+        if constexpr (requires { obj->mark_in_use(); }) obj->mark_in_use();
+        if (dirty_tracking_) touch_allocated_(obj);
+        if (sample_every_ && --sample_countdown_ == 0) sample_birth_(obj);
+        ++live_count_;
+        return obj;
+    }
+
+    // 提示对应的段组可用时返回 true，必要时为自定义编号补齐段组表
+    // True when the hint's set can be used; grows the set table for a user-defined id when needed
+    bool open_set_(AllocHint hint) {
+        if (hint.set >= max_hint_sets) return live_group_(hint);
+        if (hint.set >= sets_.size()) sets_.resize(hint.set + 1);
+        return true;
+    }
+
+    // 提示是否指向现存且代数相符的组 / Whether the hint names a live group of the same generation
+    bool live_group_(AllocHint hint) const noexcept {
+        return hint.set >= max_hint_sets && hint.set < sets_.size() && sets_[hint.set].group &&
+               sets_[hint.set].gen == hint.gen;
+    }
+
+    // PooledObject 的 mark_recycled：reset 并置回收标记 / PooledObject's mark_recycled: reset and set the recycled flag
+    static void recycle_hook_(T& obj) noexcept {
+        if constexpr (requires { obj.mark_recycled(); }) obj.mark_recycled();
+    }
+
+    // 取得一个槽位：先用空闲栈，再用未初始化空间，最后扩容
+    // Acquire a slot: free stack first, then uninitialized space, then a new segment
+    void* acquire_slot_(std::uint32_t set_id) { return acquire_slot_(set_id, limit_low_); }
+
+    // 常见情形只读空闲栈顶一项，其余情形交给 acquire_slow_，使这部分能内联进 allocate
+    // The common case reads only the top of the free stack; everything else goes to acquire_slow_,
+    // which keeps this part small enough to inline into allocate
+    void* acquire_slot_(std::uint32_t set_id, std::size_t limit) {
+        if (live_count_ >= limit) return nullptr;   // 默认 SIZE_MAX / SIZE_MAX unless set_priority_reserve was called
+        SegmentSet& set = sets_[set_id];
+        if (!set.free.empty() && !cold_tier_) {
+            const FreeSlot& f = set.free.back();
+            Segment& seg = segments_[f.seg];
+            const std::size_t slot = f.slot;
+            if (!seg.is_used(slot)) {
+                T* obj = f.obj;
+                set.free.pop_back();
+                seg.set_used(slot);
+                return obj;
+            }
+        }
+        return acquire_slow_(set_id);
+    }
+
+    // 跳过过期条目、唤醒冷段，空闲栈耗尽时切分新槽位 / Skip stale entries, warm cold segments, carve once the stack runs dry
+    SEGMENTED_POOL_NOINLINE void* acquire_slow_(std::uint32_t set_id) {
+        SegmentSet& set = sets_[set_id];
+        while (!set.free.empty()) {
+            const FreeSlot f = set.free.back();
+            set.free.pop_back();
+            Segment& seg = segments_[f.seg];
+            if (seg.is_used(f.slot)) {          // 已被 allocate_near 取走 / Taken by allocate_near
+                if (set.stale) --set.stale;
+                continue;
+            }
+            if (cold_tier_) warm_(seg);
+            seg.set_used(f.slot);
+            return f.obj;
+        }
+        return carve_slot_(set_id);
+    }
+
+    // 空闲栈为空：从当前段切分，必要时新增一段 / Free stack empty: carve from the current segment, adding one if needed
+    void* carve_slot_(std::uint32_t set_id) {
+        SegmentSet& set = sets_[set_id];
+        if (set.current == npos || segments_[set.current].next_uninit == segments_[set.current].capacity) {
+            if (frozen_) {
+                if (on_exhausted_) on_exhausted_();
+                return nullptr;
+            }
+            set.current = add_segment_(set_id);
+        }
+        Segment& seg = segments_[set.current];
+        if (cold_tier_) warm_(seg);
+        seg.set_used(seg.next_uninit);
+        return seg.data + (seg.next_uninit++) * slot_size_;
+    }
+
+    template <class Fn>
+    void for_each_in_segment_(Segment& seg, Fn&& fn) {
+        if (cold_tier_) warm_(seg);
+        const std::size_t words = (seg.next_uninit + 63) / 64;
+        for (std::size_t w = 0; w < words; ++w) {
+            std::uint64_t bits = seg.used[w];
+            while (bits) {
+                std::size_t i = w * 64 + static_cast<std::size_t>(std::countr_zero(bits));
+                bits &= bits - 1;
+                fn(*reinterpret_cast<T*>(seg.data + i * slot_size_));
+            }
+        }
+    }
+
+    // 交换两个槽位中的对象，两个槽位的代数都加一 / Swap the objects of two slots and bump both generations
+    void swap_slots_(T* a, T* b) {
+        std::size_t sa, sb;
+        Segment* seg_a = locate_(a, sa);
+        Segment* seg_b = locate_(b, sb);
+        if (cold_tier_) { warm_(*seg_a); warm_(*seg_b); }   // 任务两步之间段可能被压缩 / Segments may go cold between two steps
+        T tmp(std::move(*a));
+        a->~T();
+        ::new (a) T(std::move(*b));
+        b->~T();
+        ::new (b) T(std::move(tmp));
+        ++seg_a->gen[sa];
+        ++seg_b->gen[sb];
+        if (seqlock_) { seq_retire_(*seg_a, sa); seq_retire_(*seg_b, sb); }
+        if (sample_every_) std::swap(seg_a->born[sa], seg_b->born[sb]);
+        if (dirty_tracking_) {
+            touch(a);
+            touch(b);
+            seg_a->meta_dirty = seg_b->meta_dirty = true;   // 代数变了 / Generations changed
+        }
+        if (change_tracking_) {
+            // 变更标记跟着对象走 / Change marks follow the objects
+            const bool da = (seg_a->changed[sa >> 6] >> (sa & 63)) & 1u;
+            const bool db = (seg_b->changed[sb >> 6] >> (sb & 63)) & 1u;
+            if (da != db) {
+                seg_a->changed[sa >> 6] ^= std::uint64_t(1) << (sa & 63);
+                seg_b->changed[sb >> 6] ^= std::uint64_t(1) << (sb & 63);
+                seg_a->any_changed = seg_b->any_changed = true;
+            }
+        }
+    }
+
+    // 归还段的内存并空出下标；调用方负责段组的记录
+    // Return a segment's memory and vacate its index; the caller fixes up the set's bookkeeping
+    void free_segment_(std::size_t i) noexcept {
+        Segment& seg = segments_[i];
+        std::erase(seg_order_, i);
+        page_map_.assign(seg.data, seg.end(slot_size_) - seg.data, 0);
+        retire_indices_(seg);
+        release_memory_(seg);
+        std::fill_n(dir_.begin() + seg.first_index / dir_unit_, seg.capacity / dir_unit_, SlotHandle::invalid);
+        seg = Segment{};
+        vacant_.push_back(i);
+        --segment_count_;
+    }
+
+    // 由段表重建地址顺序、各组的段列表和空闲栈 / Rebuild address order, per-set segment lists and free stacks from the segment table
+    void rebuild_layout_() {
+        auto by_address = [this](std::size_t a, std::size_t b) { return segments_[a].data < segments_[b].data; };
+        seg_order_.clear();
+        page_map_.reset();
+        for (auto& set : sets_) { set.segs.clear(); set.free.clear(); }
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            Segment& seg = segments_[i];
+            if (!seg.data) continue;
+            seg_order_.push_back(i);
+            page_map_.assign(seg.data, seg.end(slot_size_) - seg.data, static_cast<std::uint32_t>(i + 1));
+            sets_[seg.set].segs.push_back(i);
+            for (std::size_t k = seg.next_uninit; k-- > 0;)
+                if (!seg.is_used(k)) sets_[seg.set].free.push_back(free_slot_(i, k));
+        }
+        std::sort(seg_order_.begin(), seg_order_.end(), by_address);
+        for (auto& set : sets_) std::sort(set.segs.begin(), set.segs.end(), by_address);
+    }
+
+    static constexpr std::uint64_t checkpoint_magic = 0x31544B5043504F53ull;   // "SOPCPKT1"
+
+    struct CheckpointHeader {
+        std::uint64_t magic;
+        std::uint64_t full;
+        std::uint64_t slot_size;
+        std::uint64_t page_size;
+        std::uint64_t seq;
+        std::uint64_t segments;
+    };
+
+    struct CheckpointSegment {
+        std::uint64_t capacity;       // 0 表示空位 / 0 marks a vacant entry
+        std::uint64_t next_uninit;
+        std::uint32_t set;
+        std::uint32_t first_index;
+        std::uint64_t has_meta;       // 后面跟随位图和代数 / Bitmap and generations follow
+    };
+
+    // 读入但尚未应用的段记录 / A segment record read but not yet applied
+    struct StagedSegment {
+        CheckpointSegment rec;
+        std::unique_ptr<std::uint64_t[]> used;
+        std::unique_ptr<std::uint32_t[]> gen;
+    };
+
+    // 校验第 i 条段记录并读入其旁路表。容量须是基础段容量的整数倍、编号落在 32 位全局空间内；
+    // 没有旁路表的记录只能沿用容量相同的现存段
+    // Check record i and read its side table. The capacity must be a whole number of base segments
+    // and its indices must fit the 32-bit global space; a record without a side table may only
+    // reuse an existing segment of the same capacity
+    bool stage_segment_(std::istream& in, std::uint64_t i, bool full, StagedSegment& st) const {
+        const CheckpointSegment& rec = st.rec;
+        if (rec.capacity == 0) return true;
+        if (rec.capacity % dir_unit_ != 0 || rec.first_index % dir_unit_ != 0 ||
+            rec.capacity > (std::uint64_t(1) << 32) - rec.first_index || rec.next_uninit > rec.capacity)
+            return false;
+        const bool reuse = !full && i < segments_.size() && segments_[i].data &&
+                           segments_[i].capacity == rec.capacity;
+        if (!rec.has_meta) return reuse;
+        const std::size_t cap = static_cast<std::size_t>(rec.capacity);
+        st.used = std::make_unique<std::uint64_t[]>((cap + 63) / 64);
+        st.gen = std::make_unique<std::uint32_t[]>(cap);
+        in.read(reinterpret_cast<char*>(st.used.get()), (cap + 63) / 64 * sizeof(std::uint64_t));
+        in.read(reinterpret_cast<char*>(st.gen.get()), cap * sizeof(std::uint32_t));
+        return static_cast<bool>(in);
+    }
+
+    // 按已校验的记录重建段表 / Rebuild the segment table from checked records
+    void apply_segments_(std::vector<StagedSegment>& staged) {
+        if (segments_.size() < staged.size()) segments_.resize(staged.size());
+        for (std::size_t i = 0; i < staged.size(); ++i) {
+            StagedSegment& st = staged[i];
+            const CheckpointSegment& rec = st.rec;
+            Segment& seg = segments_[i];
+            if (rec.capacity == 0) {
+                if (seg.data) release_memory_(seg);
+                seg = Segment{};
+                continue;
+            }
+            if (!seg.data || seg.capacity != rec.capacity) {
+                if (seg.data) release_memory_(seg);
+                seg = Segment{};
+                std::uint8_t mapping = map_heap;
+                std::size_t offset = 0;
+                std::byte* raw = acquire_memory_(rec.capacity * slot_size_, mapping, offset);
+                seg = Segment(raw, rec.capacity, rec.set);
+                seg.mapping = mapping;
+                seg.file_offset = offset;
+                seg.serial = ++segment_serial_;
+                track_segment_(seg);
+            }
+            seg.next_uninit = rec.next_uninit;
+            seg.set = rec.set;
+            seg.first_index = rec.first_index;
+            if (rec.has_meta) {
+                seg.used = std::move(st.used);
+                seg.gen = std::move(st.gen);
+                if (seg.seq) for (std::size_t k = 0; k < seg.capacity; ++k) seq_retire_(seg, k);
+            }
+        }
+        for (std::size_t i = staged.size(); i < segments_.size(); ++i)
+            if (segments_[i].data) { release_memory_(segments_[i]); segments_[i] = Segment{}; }
+        segments_.resize(staged.size());
+    }
+
+    template <class Pod>
+    static void write_pod_(std::ostream& out, const Pod& v) {
+        out.write(reinterpret_cast<const char*>(&v), sizeof(Pod));
+    }
+
+    template <class Pod>
+    static bool read_pod_(std::istream& in, Pod& v) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(Pod)));
+    }
+
+    // 按已开启的跟踪方式为段分配位图 / Give a segment the bitmaps of whichever tracking is enabled
+    void track_segment_(Segment& seg) {
+        if (dirty_tracking_ && !seg.dirty_pages) {
+            seg.dirty_pages = std::make_unique<std::uint64_t[]>((seg.pages(slot_size_, page_size_) + 63) / 64);
+            seg.meta_dirty = true;
+        }
+        if (change_tracking_ && !seg.changed)
+            seg.changed = std::make_unique<std::uint64_t[]>((seg.capacity + 63) / 64);
+        if (sample_every_ && !seg.born)
+            seg.born = std::make_unique<std::uint64_t[]>(seg.capacity);
+        if (seqlock_ && !seg.seq) {
+            seg.seq = std::make_unique<std::atomic<std::uint64_t>[]>(seg.capacity);
+            for (std::size_t i = 0; i < seg.capacity; ++i) seq_retire_(seg, i);
+        }
+    }
+
+    // 槽位代数变化后发布新代数并清零序号 / Publish a slot's new generation and reset its sequence
+    static void seq_retire_(Segment& seg, std::size_t slot) noexcept {
+        seg.seq[slot].store(std::uint64_t(seg.gen[slot]) << 32, std::memory_order_release);
+    }
+
+    // 只递增低 32 位序号，不进位到代数 / Bump the low 32-bit sequence without carrying into the generation
+    static std::uint64_t next_seq_(std::uint64_t s) noexcept {
+        return (s & 0xFFFFFFFF00000000ull) | static_cast<std::uint32_t>(s + 1);
+    }
+
+    static void spin_pause_() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    SEGMENTED_POOL_NOINLINE void sample_birth_(const void* p) noexcept {
+        sample_countdown_ = sample_every_;
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (seg && seg->born) seg->born[slot] = now_ns_();
+    }
+
+    static std::uint64_t now_ns_() noexcept {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count()) | 1u;   // 非零 / Never zero
+    }
+
+    static std::size_t age_bucket_(std::uint64_t ns) noexcept {
+        return std::min<std::size_t>(std::bit_width(ns), 63);
+    }
+
+    // 无锁栈：头部高 32 位是标记，低 32 位是下标 / Lock-free stack: the head holds a tag (high 32 bits) and an index (low 32 bits)
+    static constexpr std::uint64_t sig_empty = SlotHandle::invalid;
+
+    struct SignalReserve {
+        std::size_t capacity = 0;
+        std::unique_ptr<T*[]> objs;
+        std::unique_ptr<std::atomic<std::uint32_t>[]> next;
+        std::atomic<std::uint64_t> full{sig_empty};    // 可取的对象 / Objects ready to hand out
+        std::atomic<std::uint64_t> empty{sig_empty};   // 待补的位置 / Positions waiting for a refill
+    };
+
+    void sig_push_(std::atomic<std::uint64_t>& head, std::uint32_t i) noexcept {
+        std::uint64_t old = head.load(std::memory_order_relaxed);
+        do {
+            sig_->next[i].store(static_cast<std::uint32_t>(old), std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(old, ((old >> 32) + 1) << 32 | i,
+                                             std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    std::uint32_t sig_pop_(std::atomic<std::uint64_t>& head) noexcept {
+        std::uint64_t old = head.load(std::memory_order_acquire);
+        for (;;) {
+            const std::uint32_t i = static_cast<std::uint32_t>(old);
+            if (i == SlotHandle::invalid) return i;
+            const std::uint64_t next = ((old >> 32) + 1) << 32 | sig_->next[i].load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(old, next, std::memory_order_acquire, std::memory_order_acquire)) return i;
+        }
+    }
+
+    // 记录访问，冷段先解压回原地址 / Note an access; a cold segment is first decompressed in place
+    SEGMENTED_POOL_NOINLINE void warm_(Segment& seg) noexcept {
+        seg.touched = cold_epoch_;
+        if (!seg.packed) return;
+        const bool ok = detail::lz_decompress(seg.packed.get(), seg.packed_bytes, seg.data,
+                                              seg.capacity * slot_size_);
+        assert(ok && "corrupt cold segment");
+        (void)ok;
+        seg.packed.reset();
+        seg.packed_bytes = 0;
+        seg.idle_since = 0;
+    }
+
+    void warm_all_() noexcept {
+        if (cold_tier_) for (auto& seg : segments_) if (seg.data) warm_(seg);
+    }
+
+    void touch_pages_(Segment& seg, std::size_t slot) noexcept {
+        const std::size_t first = slot * slot_size_ / page_size_;
+        const std::size_t last = (slot * slot_size_ + slot_size_ - 1) / page_size_;
+        for (std::size_t pg = first; pg <= last; ++pg)
+            seg.dirty_pages[pg >> 6] |= std::uint64_t(1) << (pg & 63);
+    }
+
+    // 新分配的槽位：页面与位图都变了 / A freshly allocated slot: both its pages and the bitmap changed
+    SEGMENTED_POOL_NOINLINE void touch_allocated_(const void* p) noexcept {
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (!seg || !seg->dirty_pages) return;
+        touch_pages_(*seg, slot);
+        seg->meta_dirty = true;
+    }
+
+    static bool lock_pages_(void* p, std::size_t bytes) noexcept {
+#if defined(_WIN32)
+        return ::VirtualLock(p, bytes) != 0;
+#else
+        return ::mlock(p, bytes) == 0;
+#endif
+    }
+
+    static void unlock_pages_(void* p, std::size_t bytes) noexcept {
+#if defined(_WIN32)
+        ::VirtualUnlock(p, bytes);
+#else
+        ::munlock(p, bytes);
+#endif
+    }
+
+    // 恢复后重建其余簿记：空位、目录、计数和各组当前切分的段
+    // Rebuild the remaining bookkeeping after a restore: vacancies, directory, counts and each set's carving segment
+    void rebuild_after_restore_() {
+        vacant_.clear();
+        dir_.clear();
+        live_count_ = 0;
+        segment_count_ = 0;
+        std::uint32_t max_set = 0;
+        for (auto const& seg : segments_) max_set = std::max(max_set, seg.set);
+        if (sets_.size() <= max_set) sets_.resize(max_set + 1);
+        for (auto& set : sets_) set.current = npos;
+        for (std::size_t i = 0; i < segments_.size(); ++i) {
+            Segment& seg = segments_[i];
+            if (!seg.data) { vacant_.push_back(i); continue; }
+            const std::size_t first = seg.first_index / dir_unit_, units = seg.capacity / dir_unit_;
+            if (dir_.size() < first + units) dir_.resize(first + units, SlotHandle::invalid);
+            std::fill_n(dir_.begin() + first, units, static_cast<std::uint32_t>(i));
+            for (std::size_t w = 0, n = (seg.capacity + 63) / 64; w < n; ++w)
+                live_count_ += static_cast<std::size_t>(std::popcount(seg.used[w]));
+            if (seg.next_uninit < seg.capacity) sets_[seg.set].current = i;
+            // 检查点不记录组的代数：max_hint_sets 以上的段组按组恢复，代数沿用本池的值（新池为 0）
+            // Checkpoints do not record group generations: sets at or past max_hint_sets come back as
+            // groups keeping this pool's generation (0 in a fresh pool)
+            if (seg.set >= max_hint_sets && !sets_[seg.set].group) {
+                sets_[seg.set].group = true;
+                std::erase(free_groups_, seg.set);
+            }
+            ++segment_count_;
+        }
+        rebuild_layout_();
+    }
+
+    // 申请段内存：堆或内存文件的新切片 / Get segment memory: from the heap or a new slice of the memory file
+    std::byte* acquire_memory_(std::size_t bytes, std::uint8_t& mapping, std::size_t& offset) {
+        if (!PoolRegistry::instance().charge(registry_, bytes)) throw std::bad_alloc();   // 超出全局预算 / Over the global budget
+        try {
+            return acquire_pages_(bytes, mapping, offset);
+        } catch (...) {
+            PoolRegistry::instance().discharge(registry_, bytes);
+            throw;
+        }
+    }
+
+    std::byte* acquire_pages_(std::size_t bytes, std::uint8_t& mapping, std::size_t& offset) {
+        assert(!frozen_ && "segment allocation after freeze()");
+#if defined(__linux__)
+        if (backing_ != PoolBacking::heap) {
+            if (!memfile_) memfile_ = std::make_shared<detail::MemFile>("SegmentedObjectPool");
+            offset = memfile_->size;
+            if (::ftruncate(memfile_->fd, static_cast<off_t>(offset + bytes)) != 0) throw std::bad_alloc();
+            void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memfile_->fd, static_cast<off_t>(offset));
+            if (p == MAP_FAILED) throw std::bad_alloc();
+            memfile_->size += bytes;
+            mapping = map_shared;
+            return static_cast<std::byte*>(p);
+        }
+#endif
+        mapping = map_heap;
+        return reinterpret_cast<std::byte*>(::operator new[](bytes, std::align_val_t(seg_align_)));
+    }
+
+    // 归还段内存；没有 fork 共享内存文件时打洞释放文件页
+    // Release segment memory; punch the file pages out when no fork shares the memory file
+    void release_memory_(Segment& seg) noexcept {
+        const std::size_t bytes = seg.capacity * slot_size_;
+        PoolRegistry::instance().discharge(registry_, bytes);
+        if (locked_) unlock_pages_(seg.data, bytes);
+        seg.packed.reset();
+#if defined(__linux__)
+        if (seg.mapping != map_heap) {
+            ::munmap(seg.data, bytes);
+            if (seg.mapping == map_shared && memfile_.use_count() == 1)
+                ::fallocate(memfile_->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                            static_cast<off_t>(seg.file_offset), static_cast<off_t>(bytes));
+            return;
+        }
+#endif
+        (void)bytes;
+        ::operator delete[](seg.data, std::align_val_t(seg_align_));
+    }
+
+    // 全局槽位编号到段：目录以基础段容量为单位 / Global index to segment through a directory in units of the base segment capacity
+    Segment* segment_of_index_(std::uint32_t index, std::size_t& slot) noexcept {
+        return const_cast<Segment*>(std::as_const(*this).segment_of_index_(index, slot));
+    }
+
+    const Segment* segment_of_index_(std::uint32_t index, std::size_t& slot) const noexcept {
+        std::size_t unit = index / dir_unit_;
+        if (index == SlotHandle::invalid || unit >= dir_.size() || dir_[unit] == SlotHandle::invalid) return nullptr;
+        const Segment& seg = segments_[dir_[unit]];
+        slot = index - seg.first_index;
+        return &seg;
+    }
+
+    // 为新段分配一段连续的全局编号，优先复用空洞 / Reserve a run of global indices for a new segment, reusing holes first
+    std::uint32_t reserve_indices_(std::size_t capacity, std::size_t seg_index) {
+        const std::size_t units = capacity / dir_unit_;
+        std::size_t run = 0, start = dir_.size();
+        for (std::size_t u = 0; u < dir_.size(); ++u) {
+            run = dir_[u] == SlotHandle::invalid ? run + 1 : 0;
+            if (run == units) { start = u + 1 - units; break; }
+        }
+        if (start + units > dir_.size()) dir_.resize(start + units, SlotHandle::invalid);
+        if (dir_gen_.size() < dir_.size()) dir_gen_.resize(dir_.size(), 0);
+        assert((start + units) * dir_unit_ <= SlotHandle::invalid && "global slot index space exhausted");
+        std::fill_n(dir_.begin() + start, units, static_cast<std::uint32_t>(seg_index));
+        return static_cast<std::uint32_t>(start * dir_unit_);
+    }
+
+    // 段释放前记录各单位的代数下限，复用这些编号的新段从下限起算，旧句柄不会解析到新对象
+    // Before a segment goes, record a generation floor per unit; a new segment reusing the indices
+    // starts there, so stale handles never resolve to new objects
+    void retire_indices_(const Segment& seg) noexcept {
+        const std::size_t first = seg.first_index / dir_unit_;
+        if (dir_gen_.size() < first + seg.capacity / dir_unit_) dir_gen_.resize(first + seg.capacity / dir_unit_, 0);
+        for (std::size_t k = 0; k < seg.capacity; ++k) {
+            std::uint32_t& floor = dir_gen_[first + k / dir_unit_];
+            floor = std::max(floor, seg.gen[k] + 1);
+        }
+    }
+
+    // 在 [lo, hi) 中找离 h 最近的空闲槽位，包括下一个未初始化槽位；找不到返回 npos
+    // Find the free slot in [lo, hi) closest to h, including the next uninitialized one; npos if none
+    std::size_t find_free_near_(const Segment& seg, std::size_t h, std::size_t lo, std::size_t hi) const noexcept {
+        std::size_t best = npos, best_dist = npos;
+        auto consider = [&](std::size_t i) {
+            std::size_t d = i > h ? i - h : h - i;
+            if (d < best_dist) { best = i; best_dist = d; }
+        };
+        if (seg.next_uninit >= lo && seg.next_uninit < hi) consider(seg.next_uninit);
+        const std::size_t end = std::min(hi, seg.next_uninit);
+        if (lo >= end) return best;
+        const std::size_t first_w = lo >> 6, last_w = (end - 1) >> 6;
+        const std::size_t hw = std::clamp(h >> 6, first_w, last_w);
+        auto scan = [&](std::size_t w) {
+            std::uint64_t free = ~seg.used[w];
+            if (w == first_w) free &= ~std::uint64_t(0) << (lo & 63);
+            if (w == last_w && (end & 63)) free &= (std::uint64_t(1) << (end & 63)) - 1;
+            for (; free; free &= free - 1) consider(w * 64 + static_cast<std::size_t>(std::countr_zero(free)));
+        };
+        for (std::size_t d = 0; hw >= first_w + d || hw + d <= last_w; ++d) {
+            if (best != npos && best_dist + 64 < d * 64) break;   // 更远的字不会更近 / Farther words cannot be closer
+            if (hw + d <= last_w) scan(hw + d);
+            if (d && hw >= first_w + d) scan(hw - d);
+        }
+        return best;
+    }
+
+    void release_slot_(T* p) noexcept {
+        assert(reorder_jobs_ == 0 && "deallocation while a ReorderJob is active");
+        std::size_t slot;
+        Segment* seg = locate_(p, slot);
+        if (seg) release_in_(*seg, slot, p);
+    }
+
+    // 已知所在段时的回收，collect 批量清除时免去逐个查段 / Release with the segment known; collect's sweep skips the lookup
+    void release_in_(Segment& seg, std::size_t slot, T* p) noexcept {
+        SegmentSet& set = sets_[seg.set];
+        if (set.stale && (set.stale > set.free.size() / 2 || set.free.size() == set.free.capacity())) compact_free_(set);
+        seg.clear_used(slot);
+        if (dirty_tracking_ || seg.changed || seg.seq || seg.born) release_extras_(seg, slot);
+        assert((!frozen_ || set.free.size() < set.free.capacity()) && "free stack growth after freeze()");
+        set.free.push_back(FreeSlot{p, static_cast<std::uint32_t>(&seg - segments_.data()),
+                                    static_cast<std::uint32_t>(slot)});  // 直接压入 stack
+    }
+
+    // 回收时各项可选功能的簿记 / Bookkeeping of the optional features on release
+    SEGMENTED_POOL_NOINLINE void release_extras_(Segment& seg, std::size_t slot) noexcept {
+        if (dirty_tracking_) seg.meta_dirty = true;
+        if (seg.changed) seg.changed[slot >> 6] &= ~(std::uint64_t(1) << (slot & 63));
+        if (seg.seq) seq_retire_(seg, slot);
+        if (seg.born && seg.born[slot]) {
+            ++lifetime_hist_[age_bucket_(now_ns_() - seg.born[slot])];
+            seg.born[slot] = 0;
+        }
+    }
+
+    FreeSlot free_slot_(std::size_t seg, std::size_t slot) const noexcept {
+        return FreeSlot{reinterpret_cast<T*>(segments_[seg].data + slot * slot_size_),
+                        static_cast<std::uint32_t>(seg), static_cast<std::uint32_t>(slot)};
+    }
+
+    // 去掉空闲栈中已被占用的条目和重复条目；借占用位做去重标记，不改代数
+    // Drop free-stack entries whose slot is in use, and duplicates; the occupancy bit serves as the
+    // seen-mark, without touching generations
+    SEGMENTED_POOL_NOINLINE void compact_free_(SegmentSet& set) noexcept {
+        std::size_t kept = 0;
+        for (const FreeSlot& f : set.free) {
+            Segment& seg = segments_[f.seg];
+            if (seg.is_used(f.slot)) continue;
+            seg.set_used(f.slot);
+            set.free[kept++] = f;
+        }
+        set.free.resize(kept);
+        for (const FreeSlot& f : set.free)
+            segments_[f.seg].used[f.slot >> 6] &= ~(std::uint64_t(1) << (f.slot & 63));
+        set.stale = 0;
+    }
+
+    // 指针到段的查找：经页表 O(1) 定位；页表未能登记全部段时才对按地址排序的段表二分。
+    // 非 const 版本先试上次命中的段：连续的回收多半落在同一段，省去页表的几次相依读取
+    // Pointer-to-segment lookup: O(1) through the page map; binary search by address only when the
+    // map could not record every segment. The non-const overload tries the last segment hit first:
+    // consecutive deallocations mostly land in one segment, which skips the page map's chain of loads
+    Segment* locate_(const void* p, std::size_t& slot) noexcept {
+        auto* b = static_cast<const std::byte*>(p);
+        if (hot_seg_ < segments_.size()) {
+            Segment& seg = segments_[hot_seg_];
+            if (b >= seg.data && b < seg.end(slot_size_)) {
+                slot = detail::divide(static_cast<std::size_t>(b - seg.data), slot_size_, slot_recip_);
+                return &seg;
+            }
+        }
+        Segment* seg = const_cast<Segment*>(std::as_const(*this).locate_(p, slot));
+        if (seg) hot_seg_ = static_cast<std::size_t>(seg - segments_.data());
+        return seg;
+    }
+
+    const Segment* locate_(const void* p, std::size_t& slot) const noexcept {
+        auto* b = static_cast<const std::byte*>(p);
+        const Segment* seg;
+        if (const std::uint32_t hit = page_map_.find(p)) {
+            seg = &segments_[hit - 1];
+            if (b >= seg->end(slot_size_)) return nullptr;
+        } else {
+            if (page_map_.complete() || seg_order_.empty()) return nullptr;
+            auto it = std::upper_bound(seg_order_.begin(), seg_order_.end(), b,
+                [this](const std::byte* x, std::size_t i) { return x < segments_[i].data; });
+            if (it == seg_order_.begin()) return nullptr;
+            seg = &segments_[*(it - 1)];
+            if (b >= seg->end(slot_size_)) return nullptr;
+        }
+        slot = detail::divide(static_cast<std::size_t>(b - seg->data), slot_size_, slot_recip_);
+        return seg;
+    }
+
+    std::size_t compute_min_pages(std::size_t user_min_pages) const noexcept {
+        return detail::min_segment_pages(page_size_, slot_size_, user_min_pages);
+    }
+
+    // 为段组新增一段，返回段下标 / Add a segment to a set; returns the segment index
+    std::size_t add_segment_(std::uint32_t set_id) {
+        SegmentSet& set = sets_[set_id];
+        if (set.next_pages_hint == 0) {
+            set.next_pages_hint = pages_per_segment_base_;
+        } else {
+            double target = static_cast<double>(set.next_pages_hint) * growth_factor_;
+            std::size_t pages = static_cast<std::size_t>(target);
+            if (pages < set.next_pages_hint + pages_per_segment_base_)
+                pages = set.next_pages_hint + pages_per_segment_base_;
+            std::size_t rem = pages % pages_per_segment_base_;
+            if (rem) pages += (pages_per_segment_base_ - rem);
+            set.next_pages_hint = pages;
+        }
+        const std::size_t seg_bytes = set.next_pages_hint * page_size_;
+        const std::size_t capacity = seg_bytes / slot_size_;
+        std::size_t offset = 0;
+        std::uint8_t mapping = map_heap;
+        std::byte* raw = acquire_memory_(seg_bytes, mapping, offset);
+        std::size_t index;
+        if (!vacant_.empty()) {
+            index = vacant_.back();
+            vacant_.pop_back();
+            segments_[index] = Segment(raw, capacity, set_id);
+        } else {
+            index = segments_.size();
+            segments_.emplace_back(raw, capacity, set_id);
+        }
+        segments_[index].mapping = mapping;
+        segments_[index].file_offset = offset;
+        segments_[index].serial = ++segment_serial_;
+        segments_[index].first_index = reserve_indices_(capacity, index);
+        {
+            Segment& seg = segments_[index];
+            const std::size_t first = seg.first_index / dir_unit_;
+            for (std::size_t k = 0; k < capacity; ++k) seg.gen[k] = dir_gen_[first + k / dir_unit_];
+        }
+        track_segment_(segments_[index]);
+        if (locked_) lock_pages_(raw, seg_bytes);
+        auto by_address = [this](const std::byte* x, std::size_t i) { return x < segments_[i].data; };
+        seg_order_.insert(std::upper_bound(seg_order_.begin(), seg_order_.end(), raw, by_address), index);
+        page_map_.assign(raw, seg_bytes, static_cast<std::uint32_t>(index + 1));
+        set.segs.insert(std::upper_bound(set.segs.begin(), set.segs.end(), raw, by_address), index);
+        ++segment_count_;
+        return index;
+    }
+
+private:
+    PoolBacking backing_ = PoolBacking::heap;
+#if defined(__linux__)
+    std::shared_ptr<detail::MemFile> memfile_;
+#endif
+    std::vector<Segment> segments_;
+    std::vector<std::size_t> seg_order_;   // 按地址排序的段下标 / Segment indices sorted by address
+    detail::PageMap page_map_{detail::os_page_size()};   // 页到段的 O(1) 查找 / O(1) page-to-segment lookup
+    std::size_t hot_seg_ = npos;           // locate_ 上次命中的段 / Segment locate_ hit last
+    std::vector<std::size_t> vacant_;      // 释放后空出的段下标 / Segment indices vacated by trim or release_group
+    std::vector<std::uint32_t> free_groups_;   // 可复用的组编号 / Released group ids available for reuse
+    std::size_t segment_count_ = 0;
+    std::size_t reorder_jobs_ = 0;         // 存活的重排任务数 / Number of live ReorderJobs
+    bool dirty_tracking_ = false;          // 页粒度脏页跟踪 / Page-granular dirty tracking
+    std::uint64_t checkpoint_seq_ = 0;     // 下一个检查点序号 / Sequence number of the next checkpoint
+    bool change_tracking_ = false;         // 逐槽变更跟踪 / Per-slot change tracking
+    bool seqlock_ = false;                 // 逐槽顺序锁 / Per-slot seqlock words
+    std::uint64_t segment_serial_ = 0;     // 最近分配的段序列号 / Last segment serial handed out
+    std::uint32_t sample_every_ = 0;       // 寿命采样间隔 / Lifetime sampling interval
+    bool locked_ = false;                  // 段页面已锁定 / Segment pages are locked in memory
+    bool frozen_ = false;                  // 禁止增长 / Growth forbidden
+    std::function<void()> on_exhausted_;   // 冻结后耗尽时调用 / Called when exhausted while frozen
+    std::unique_ptr<SignalReserve> sig_;   // 信号安全保留对象 / Async-signal-safe reserve
+    std::vector<SlotHandle> roots_;        // 标记-清除的根集合 / Mark-sweep root set
+    std::size_t limit_low_ = SIZE_MAX;     // 普通分配的存活上限 / Live-object limit for normal allocations
+    std::size_t limit_high_ = SIZE_MAX;    // 高优先级分配的存活上限 / Live-object limit for priority::high
+    bool cold_tier_ = false;               // 冷段压缩 / Cold-segment compression
+    std::uint64_t cold_idle_ = 0;          // 压缩前的空闲时长（纳秒） / Idle time before compression, in ns
+    std::uint64_t cold_epoch_ = 1;         // 冷段扫描轮次 / Cold-tier sweep counter
+    std::uint32_t sample_countdown_ = 0;
+    std::array<std::uint64_t, 64> lifetime_hist_{};
+    std::vector<std::uint32_t> dir_;       // 全局编号目录：单位 -> 段下标 / Global index directory: unit -> segment index
+    std::vector<std::uint32_t> dir_gen_;   // 各单位复用时的起始代数 / Starting generation of each unit on reuse
+    std::size_t page_size_ = detail::os_page_size();
+    std::size_t slot_size_ = 0;
+    std::uint64_t slot_recip_ = 0;         // slot_size_ 的定点倒数 / Fixed-point reciprocal of slot_size_
+    std::size_t seg_align_ = alignof(T);
+    std::size_t pages_per_segment_base_ = 0;
+    std::size_t dir_unit_ = 1;             // 基础段容量 / Slots in a base-sized segment
+    double growth_factor_ = 1.0;
+    PoolRegistry::Entry* registry_ = nullptr;   // 在全局登记表中的条目 / Entry in the global registry
+    std::size_t live_count_ = 0;
+
+    // Thread-safe lock
+    SpinLock lock_;
+};
+
+// ----------------------------
+// 类级 operator new/delete 路由 / Class-level operator new/delete routing
+// ----------------------------
+namespace detail {
+template <class Derived, bool Route>
+struct PooledNew {};
+
+// 对象内的回收标记；使用旁路表时为空 / In-object recycled flag; empty when the side table is used
+template <bool InObject>
+struct RecycledFlag { bool value = false; };
+
+template <>
+struct RecycledFlag<false> {};
+
+// new Derived 走 SegmentedObjectPool<Derived>；更大或对齐更严格的派生类回退到全局 new。
+// 同一个 size 总是得到同一判定，因此 sized delete 能找回来源。
+// new Derived goes through SegmentedObjectPool<Derived>; larger or stricter-aligned derived
+// classes fall back to global new. The decision depends only on size, so sized delete can
+// tell where the memory came from.
+template <class Derived>
+struct PooledNew<Derived, true> {
+    static void* operator new(std::size_t sz) {
+        if (routed_(sz, std::min<std::size_t>(__STDCPP_DEFAULT_NEW_ALIGNMENT__, low_bit(sz))))
+            return pooled_();
+        return ::operator new(sz);
+    }
+    static void* operator new(std::size_t sz, std::align_val_t al) {
+        if (routed_(sz, static_cast<std::size_t>(al)))
+            return pooled_();
+        return ::operator new(sz, al);
+    }
+    static void* operator new(std::size_t sz, const std::nothrow_t&) noexcept {
+        try { return operator new(sz); } catch (...) { return nullptr; }
+    }
+    static void* operator new(std::size_t sz, std::align_val_t al, const std::nothrow_t&) noexcept {
+        try { return operator new(sz, al); } catch (...) { return nullptr; }
+    }
+    // 类级 new 会隐藏全局 placement new，这里补回 / Class-level new hides global placement new; restore it
+    static void* operator new(std::size_t, void* where) noexcept { return where; }
+
+    static void operator delete(void* p, std::size_t sz) noexcept {
+        if (routed_(sz, std::min<std::size_t>(__STDCPP_DEFAULT_NEW_ALIGNMENT__, low_bit(sz))))
+            pool_().atomic_deallocate_raw(p);
+        else
+            ::operator delete(p, sz);
+    }
+    static void operator delete(void* p, std::size_t sz, std::align_val_t al) noexcept {
+        if (routed_(sz, static_cast<std::size_t>(al)))
+            pool_().atomic_deallocate_raw(p);
+        else
+            ::operator delete(p, sz, al);
+    }
+    // nothrow new 构造失败时调用，没有 size 只能按地址判断 / Called when a nothrow-new constructor throws; no size, so check the address
+    static void operator delete(void* p, const std::nothrow_t&) noexcept {
+        if (owned_(p)) pool_().atomic_deallocate_raw(p);
+        else ::operator delete(p);
+    }
+    static void operator delete(void* p, std::align_val_t al, const std::nothrow_t&) noexcept {
+        if (owned_(p)) pool_().atomic_deallocate_raw(p);
+        else ::operator delete(p, al);
+    }
+    static void operator delete(void*, void*) noexcept {}
+
+private:
+    static SegmentedObjectPool<Derived>& pool_() { return SegmentedObjectPool<Derived>::instance(); }
+    static bool routed_(std::size_t sz, std::size_t align) { return pool_().fits(sz, align); }
+    static bool owned_(void* p) { return pool_().atomic_contains(p); }
+    // 冻结的池耗尽时返回 nullptr，这里转成 bad_alloc / A frozen, exhausted pool returns nullptr; turn it into bad_alloc
+    static void* pooled_() {
+        if (void* p = pool_().atomic_allocate_raw()) return p;
+        throw std::bad_alloc();
+    }
+};
+} // namespace detail
+
+// ----------------------------
+// PooledObject 基类 / Base class for pooled objects
+// Features 为 PoolFeature 位组合 / Features is a combination of PoolFeature bits
+// ----------------------------
+template <class Derived, unsigned Features = pool_default>
+struct PooledObject : detail::PooledNew<Derived, (Features & pool_route_new) != 0> {
+    static constexpr unsigned pool_features = Features;
+
+    virtual ~PooledObject() = default;
+    virtual void reset() {}
+
+    // 用于极致性能场景的线程不安全创建方法 / Thread-unsafe creation method for extreme performance scenarios
+    static Derived* create(auto&&... args) {
+        return SegmentedObjectPool<Derived>::instance().allocate(std::forward<decltype(args)>(args)...);
+    }
+
+    // 线程安全版本的创建方法 Thread-safe version of the create method
+    static Derived* atomic_create(auto&&... args) {
+        return SegmentedObjectPool<Derived>::instance().atomic_allocate(std::forward<decltype(args)>(args)...);
+    }
+
+    // 在 hint 附近创建，便于相关对象共享缓存行和页面 / Create near hint so related objects share cache lines and pages
+    static Derived* create_near(const Derived* hint, auto&&... args) {
+        return SegmentedObjectPool<Derived>::instance().allocate_near(hint, std::forward<decltype(args)>(args)...);
+    }
+
+    // 信号处理函数中使用，取自 reserve_for_signals 的保留对象 / For signal handlers; taken from the reserve_for_signals reserve
+    static Derived* signal_create() noexcept {
+        return SegmentedObjectPool<Derived>::instance().signal_allocate();
+    }
+
+    // 用于极致性能场景的线程不安全回收方法 / Thread-unsafe recycle method for extreme performance scenarios
+    inline void recycle() {
+        mark_recycled();
+        SegmentedObjectPool<Derived>::instance().deallocate(static_cast<Derived*>(this));
+    }
+
+    // 线程安全版本的回收方法 Thread-safe version of the recycling method
+    inline void atomic_recycle() {
+        mark_recycled();
+        SegmentedObjectPool<Derived>::instance().atomic_deallocate(static_cast<Derived*>(this));
+    }
+
+    // 回收前的共同步骤，池代为回收（定时器、回滚、release_group、collect）时也会调用
+    // The common step before recycling; also called when the pool recycles on the object's behalf
+    // (timers, rollback, release_group, collect)
+    inline void mark_recycled() {
+        this->reset();
+        if constexpr (!side_table) recycled_.value = true;
+    }
+
+    // 使用旁路表时通过指针查段得到 / With the side table, answered through a pointer-to-segment lookup
+    inline bool is_recycled() const noexcept {
+        if constexpr (side_table)
+            return SegmentedObjectPool<Derived>::instance().is_recycled(this);
+        else
+            return recycled_.value;
+    }
+    inline void mark_in_use() noexcept {
+        if constexpr (!side_table) recycled_.value = false;
+    }
+
+    // 标记本对象已修改，供 for_each_dirty_and_clear 使用 / Mark this object as modified for for_each_dirty_and_clear
+    inline void mark_dirty() noexcept {
+        SegmentedObjectPool<Derived>::instance().mark_dirty(this);
+    }
+
+private:
+    static constexpr bool side_table = (Features & pool_side_table) != 0;
+    [[no_unique_address]] detail::RecycledFlag<!side_table> recycled_;
+};
+
+// ----------------------------
+// 池内相对指针：保存 32 位全局槽位编号而非地址，大小为裸指针的一半。
+// 编号经段目录解析，段在 fork、检查点恢复或共享映射到其他地址后依然有效。
+// 默认指向 SegmentedObjectPool<T>::instance()；其他池的对象用 get(pool) 解引用。
+// 不检查代数，悬空时与裸指针一样未定义；需要检测回收时用 SlotHandle。
+// Pool-relative pointer: stores the 32-bit global slot index instead of an address, half the size
+// of a raw pointer. The index is resolved through the segment directory, so it stays valid after
+// fork, checkpoint restore, or mapping the segments at another address.
+// Refers to SegmentedObjectPool<T>::instance() by default; dereference objects of other pools with
+// get(pool). No generation check: dangling use is as undefined as with a raw pointer; use SlotHandle
+// when recycling must be detected.
+// ----------------------------
+template <class T>
+class pool_ptr {
+public:
+    using element_type = T;
+    using pool_type = SegmentedObjectPool<std::remove_const_t<T>>;
+
+    pool_ptr() noexcept = default;
+    pool_ptr(std::nullptr_t) noexcept {}
+    explicit pool_ptr(T* p) : pool_ptr(p, pool_type::instance()) {}
+    pool_ptr(T* p, const pool_type& pool) noexcept : index_(p ? pool.index_of(p) : SlotHandle::invalid) {
+        assert((!p || index_ != SlotHandle::invalid) && "pool_ptr to an object outside the pool");
+    }
+
+    static pool_ptr from_index(std::uint32_t index) noexcept { pool_ptr r; r.index_ = index; return r; }
+    std::uint32_t index() const noexcept { return index_; }
+
+    T* get() const noexcept { return get(pool_type::instance()); }
+    T* get(pool_type& pool) const noexcept {
+        return index_ == SlotHandle::invalid ? nullptr : pool.at_index(index_);
+    }
+
+    T& operator*() const noexcept { return *get(); }
+    T* operator->() const noexcept { return get(); }
+    explicit operator bool() const noexcept { return index_ != SlotHandle::invalid; }
+
+    void reset() noexcept { index_ = SlotHandle::invalid; }
+    friend bool operator==(pool_ptr, pool_ptr) = default;
+    friend bool operator==(pool_ptr p, std::nullptr_t) noexcept { return !p; }
+
+private:
+    std::uint32_t index_ = SlotHandle::invalid;
+};
+
+// ----------------------------
+// 分层时间轮：池内对象的超时回收 / Hierarchical timing wheel: timeout-driven recycling of pooled objects
+// 定时器只记录对象句柄，不持有指针；对象提前回收后定时器自动失效。
+// 节点本身也由对象池分配，schedule / cancel 为 O(1)，advance 批量回收到期对象。非线程安全。
+// Timers record object handles rather than pointers, so a timer whose object was recycled early
+// simply lapses. Timer nodes come from a pool of their own; schedule / cancel are O(1) and
+// advance recycles expired objects in one batch. Not thread-safe.
+// ----------------------------
+template <class T>
+class PoolTimerWheel {
+public:
+    using TimerId = SlotHandle;
+
+    explicit PoolTimerWheel(SegmentedObjectPool<T>& pool, std::uint64_t now = 0) : pool_(pool), now_(now) {}
+    PoolTimerWheel(const PoolTimerWheel&) = delete;
+    PoolTimerWheel& operator=(const PoolTimerWheel&) = delete;
+
+    // 在 expires_at（与 advance 同一时间单位）回收 obj；已过期的时间在下一个刻度触发
+    // Recycle obj at expires_at (same unit as advance); past times fire on the next tick
+    TimerId schedule(const T* obj, std::uint64_t expires_at) {
+        Node* n = nodes_.allocate(Node{pool_.handle_of(obj), expires_at});
+        link_(n, now_ + 1);
+        return nodes_.handle_of(n);
+    }
+
+    // 取消定时器，已触发或已取消时返回 false / Cancel a timer; false if it already fired or was cancelled
+    bool cancel(TimerId id) noexcept {
+        Node* n = nodes_.resolve(id);
+        if (!n) return false;
+        unlink_(n);
+        nodes_.deallocate(n);
+        return true;
+    }
+
+    // 推进到 now，扫完整个区间后对每个到期且仍存活的对象调用 on_expire(T&) 并回收；返回回收数
+    // Advance to now: call on_expire(T&) for every expired object still alive and recycle it,
+    // after the whole range has been swept; returns how many were recycled
+    template <class Fn>
+    std::size_t advance(std::uint64_t now, Fn&& on_expire) {
+        expired_.clear();
+        while (now_ < now) {
+            if (pending_ == 0) { now_ = now; break; }
+            std::uint64_t t = now_ + 1;
+            if (t & slot_mask) {
+                // 跳到本轮下一个非空桶或下一个进位点 / Skip to the next busy bucket or the next carry
+                const std::uint64_t busy = occupied_[0] >> (t & slot_mask);
+                const std::uint64_t next = busy ? t + static_cast<std::uint64_t>(std::countr_zero(busy))
+                                                : (t | slot_mask) + 1;
+                if (next > now) { now_ = now; break; }
+                t = next;
+            }
+            now_ = t;
+            for (unsigned level = 1; level < levels && (t & ((std::uint64_t(1) << (bits * level)) - 1)) == 0; ++level)
+                cascade_(level, (t >> (bits * level)) & slot_mask);
+            fire_(t & slot_mask);
+        }
+        std::size_t recycled = 0;
+        for (SlotHandle h : expired_) {
+            // 同一对象的重复定时器只回收一次 / Duplicate timers on one object recycle it once
+            if (T* obj = pool_.resolve(h)) {
+                on_expire(*obj);
+                pool_.recycle(obj);
+                ++recycled;
+            }
+        }
+        return recycled;
+    }
+
+    std::size_t advance(std::uint64_t now) { return advance(now, [](T&) {}); }
+
+    std::uint64_t now() const noexcept { return now_; }
+    std::size_t pending() const noexcept { return pending_; }
+
+private:
+    static constexpr unsigned bits = 6;                        // 每层 64 个桶 / 64 buckets per level
+    static constexpr unsigned levels = 4;                      // 覆盖 2^24 个刻度 / Spans 2^24 ticks
+    static constexpr std::uint64_t slot_mask = (1u << bits) - 1;
+    static constexpr std::uint64_t max_delta = (std::uint64_t(1) << (bits * levels)) - (std::uint64_t(1) << (bits * (levels - 1)));
+
+    struct Node {
+        SlotHandle target;
+        std::uint64_t expires = 0;
+        Node* prev = nullptr;
+        Node* next = nullptr;
+        std::uint32_t bucket = 0;     // level * 64 + 桶号 / level * 64 + bucket
+    };
+
+    // 按与当前时间最高的不同位组选层；超出范围的先挂在顶层，进位时重新放置。
+    // 新定时器最早在下一刻度；进位下放时允许当前刻度，紧接着的 fire_ 会处理它
+    // Pick the level from the highest bit group that differs from now; timers beyond the span park
+    // in the top level and are re-placed when it carries. New timers go no earlier than the next
+    // tick; a cascade may place one at the current tick, which the following fire_ handles
+    void link_(Node* n, std::uint64_t earliest) noexcept {
+        std::uint64_t e = std::max(n->expires, earliest);
+        if (e - now_ > max_delta) e = now_ + max_delta;
+        unsigned level = 0;
+        while (level + 1 < levels && ((e ^ now_) >> (bits * (level + 1))) != 0) ++level;
+        const std::uint32_t b = level * (slot_mask + 1) + static_cast<std::uint32_t>((e >> (bits * level)) & slot_mask);
+        n->bucket = b;
+        n->prev = nullptr;
+        n->next = heads_[b];
+        if (n->next) n->next->prev = n;
+        heads_[b] = n;
+        occupied_[level] |= std::uint64_t(1) << (b & slot_mask);
+        ++pending_;
+    }
+
+    void unlink_(Node* n) noexcept {
+        const std::uint32_t b = n->bucket;
+        if (n->prev) n->prev->next = n->next;
+        else heads_[b] = n->next;
+        if (n->next) n->next->prev = n->prev;
+        if (!heads_[b]) occupied_[b >> bits] &= ~(std::uint64_t(1) << (b & slot_mask));
+        --pending_;
+    }
+
+    Node* take_(std::uint32_t b) noexcept {
+        Node* list = heads_[b];
+        heads_[b] = nullptr;
+        occupied_[b >> bits] &= ~(std::uint64_t(1) << (b & slot_mask));
+        return list;
+    }
+
+    void cascade_(unsigned level, std::uint64_t slot) noexcept {
+        for (Node* n = take_(level * (slot_mask + 1) + static_cast<std::uint32_t>(slot)); n;) {
+            Node* next = n->next;
+            --pending_;
+            link_(n, now_);
+            n = next;
+        }
+    }
+
+    void fire_(std::uint64_t slot) {
+        for (Node* n = take_(static_cast<std::uint32_t>(slot)); n;) {
+            Node* next = n->next;
+            --pending_;
+            if (n->expires > now_) {
+                link_(n, now_ + 1);   // 超出跨度的定时器 / A timer beyond the span
+            } else {
+                expired_.push_back(n->target);
+                nodes_.deallocate(n);
+            }
+            n = next;
+        }
+    }
+
+    SegmentedObjectPool<T>& pool_;
+    SegmentedObjectPool<Node> nodes_;
+    Node* heads_[levels << bits] = {};
+    std::uint64_t occupied_[levels] = {};
+    std::uint64_t now_ = 0;
+    std::size_t pending_ = 0;
+    std::vector<SlotHandle> expired_;
 };
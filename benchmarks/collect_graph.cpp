@@ -0,0 +1,46 @@
+// 标记-清除回收：100 万节点的随机图，每个节点的两条边各以 3/4 的概率存在（约 1.5 条边），
+// 100 个随机根；先回收不可达节点（含析构），再跑一轮没有垃圾的标记
+// Mark-sweep collection: a random graph of 1M nodes whose two edges each exist with probability
+// 3/4 (about 1.5 edges per node) and 100 random roots; one collection reclaiming the unreachable
+// nodes (destructors included), then a mark-only pass with no garbage left
+//
+//   g++ -O2 -std=c++20 -I. benchmarks/collect_graph.cpp -o collect_graph
+#include "SegmentedObjectPool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+struct Node {
+    long id;
+    Node* a = nullptr;
+    pool_ptr<Node> b;
+    std::vector<int> payload;   // 析构有实际开销 / Gives the destructor real work
+    explicit Node(long i) : id(i), payload(3, static_cast<int>(i)) {}
+    template <class V> void trace(V& v) const { v(a); v(b); }
+};
+
+constexpr long nodes = 1000000;
+
+int main() {
+    using ms = std::chrono::duration<double, std::milli>;
+    auto& pool = SegmentedObjectPool<Node>::instance();
+    std::mt19937 rng(5);
+    std::vector<Node*> all;
+    all.reserve(nodes);
+    for (long i = 0; i < nodes; ++i) all.push_back(pool.allocate(i));
+    for (long i = 0; i < nodes; ++i) {
+        if (rng() % 4) all[i]->a = all[rng() % nodes];
+        if (rng() % 4) all[i]->b = pool_ptr<Node>(all[rng() % nodes]);
+    }
+    for (int k = 0; k < 100; ++k) pool.add_root(all[rng() % nodes]);
+
+    auto t0 = std::chrono::steady_clock::now();
+    const std::size_t freed = pool.collect();
+    auto t1 = std::chrono::steady_clock::now();
+    const std::size_t again = pool.collect();
+    auto t2 = std::chrono::steady_clock::now();
+    if (again != 0) std::puts("mismatch");
+
+    std::printf("freed %zu of %ld in %.0f ms\nmark-only pass over %zu in %.0f ms\n", freed, nodes,
+                ms(t1 - t0).count(), pool.live(), ms(t2 - t1).count());
+}
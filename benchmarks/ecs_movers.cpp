@@ -0,0 +1,48 @@
+// ECS 列遍历与对象池 AoS 遍历的对比：100 万实体，半数带 Vel，每隔两个销毁一个；
+// 对带 Vel 的实体做 20 轮位移更新，报告每轮耗时
+// ECS column walks against AoS walks over a pool: 1M entities, half of them with Vel, every third
+// one destroyed; 20 passes of position updates over the entities with Vel, time per pass
+//
+//   g++ -O2 -std=c++20 -I. benchmarks/ecs_movers.cpp -o ecs_movers
+#include "SegmentedECS.hpp"
+#include <chrono>
+#include <cstdio>
+
+struct Pos { float x, y, z; };
+struct Vel { float x, y, z; };
+struct Mover { Pos p; Vel v; bool has_vel; };
+
+constexpr int entities = 1000000;
+constexpr int passes = 20;
+
+int main() {
+    using us = std::chrono::duration<double, std::micro>;
+
+    EcsWorld world;
+    std::vector<Entity> es;
+    es.reserve(entities);
+    for (int i = 0; i < entities; ++i)
+        es.push_back(i % 2 ? world.create(Pos{float(i), 0, 0}, Vel{1, 0, 0}) : world.create(Pos{float(i), 0, 0}));
+    for (int i = 0; i < entities; i += 3) world.destroy(es[i]);
+
+    auto movers = world.query<Pos, Vel>();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < passes; ++r)
+        movers.each_chunk([](std::size_t n, const Entity*, Pos* p, Vel* v) {
+            for (std::size_t i = 0; i < n; ++i) { p[i].x += v[i].x; p[i].y += v[i].y; p[i].z += v[i].z; }
+        });
+    auto t1 = std::chrono::steady_clock::now();
+
+    SegmentedObjectPool<Mover> pool;
+    for (int i = 0; i < entities; ++i)
+        if (i % 3) pool.allocate(Mover{{float(i), 0, 0}, {1, 0, 0}, i % 2 == 1});
+    auto t2 = std::chrono::steady_clock::now();
+    for (int r = 0; r < passes; ++r)
+        pool.for_each([](Mover& m) {
+            if (m.has_vel) { m.p.x += m.v.x; m.p.y += m.v.y; m.p.z += m.v.z; }
+        });
+    auto t3 = std::chrono::steady_clock::now();
+
+    std::printf("%zu movers\necs      %.0f us/pass\npool AoS %.0f us/pass\n", movers.count(),
+                us(t1 - t0).count() / passes, us(t3 - t2).count() / passes);
+}
@@ -0,0 +1,40 @@
+// 写时复制 fork：100 万个 32 字节持仓放在 memfd 后备的池中，测 fork、在 fork 中改写 1000 个对象、
+// 销毁 fork 的耗时，各重复 20 次取平均
+// Copy-on-write fork: 1M 32-byte positions in a memfd-backed pool; times fork(), rewriting 1000
+// objects in the fork and destroying it, averaged over 20 rounds
+//
+//   g++ -O2 -std=c++20 -I. benchmarks/fork_whatif.cpp -o fork_whatif
+#include "SegmentedObjectPool.hpp"
+#include <chrono>
+#include <cstdio>
+
+struct Position { long id; long qty; double px; double pnl; };
+
+constexpr long positions = 1000000;
+constexpr int rounds = 20;
+
+int main() {
+    using ms = std::chrono::duration<double, std::milli>;
+    SegmentedObjectPool<Position> book(0, 2.0, PoolBacking::memfd);
+    std::vector<SlotHandle> handles;
+    handles.reserve(positions);
+    for (long i = 0; i < positions; ++i) handles.push_back(book.handle_of(book.allocate(Position{i, 100, 1.0, 0})));
+
+    ms fork_time{}, write_time{}, destroy_time{};
+    for (int r = 0; r < rounds; ++r) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto what_if = book.fork();
+        auto t1 = std::chrono::steady_clock::now();
+        for (long i = 0; i < positions; i += positions / 1000) what_if->resolve(handles[i])->qty += 10;
+        auto t2 = std::chrono::steady_clock::now();
+        what_if.reset();
+        auto t3 = std::chrono::steady_clock::now();
+        fork_time += t1 - t0;
+        write_time += t2 - t1;
+        destroy_time += t3 - t2;
+    }
+    if (book.resolve(handles[0])->qty != 100) std::puts("mismatch");
+
+    std::printf("fork    %.1f ms\nwrite   %.1f ms\ndestroy %.1f ms\n", fork_time.count() / rounds,
+                write_time.count() / rounds, destroy_time.count() / rounds);
+}
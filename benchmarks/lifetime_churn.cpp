@@ -0,0 +1,51 @@
+// 双峰寿命负载下寿命提示对 trim 的影响：200 万次分配，5% 长寿命；前半程短寿命对象峰值 20 万，
+// 后半程 2000。排空短寿命对象后 trim()，报告 RSS 与槽位密度。带参数运行时使用寿命提示（Linux）：
+// Effect of lifetime hints on trim under a bimodal load: 2M allocations, 5% long-lived; the
+// short-lived peak is 200k in the first half and 2000 in the second. Short-lived objects are
+// drained, then trim() runs; reports RSS and slot density. Any argument turns hints on (Linux):
+//
+//   g++ -O2 -std=c++20 -I. benchmarks/lifetime_churn.cpp -o lifetime_churn
+//   ./lifetime_churn && ./lifetime_churn hints
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <random>
+
+struct Order { long id; double px, qty; char pad[40]; explicit Order(long i = 0) : id(i), px(0), qty(0) {} };
+
+static long rss_kib() {
+    std::ifstream f("/proc/self/statm");
+    long size = 0, resident = 0;
+    f >> size >> resident;
+    return resident * static_cast<long>(detail::os_page_size() / 1024);
+}
+
+int main(int argc, char**) {
+    const bool hints = argc > 1;
+    const AllocHint long_hint = hints ? hint_long_lived : hint_default;
+    const AllocHint short_hint = hints ? hint_short_lived : hint_default;
+    SegmentedObjectPool<Order> pool;
+    std::mt19937 rng(42);
+    std::vector<Order*> long_lived;
+    std::deque<Order*> short_lived;
+
+    const long base = rss_kib();
+    for (long i = 0; i < 2000000; ++i) {
+        if (rng() % 20 == 0) long_lived.push_back(pool.allocate(long_hint, i));
+        else short_lived.push_back(pool.allocate(short_hint, i));
+        const std::size_t peak = i < 1000000 ? 200000 : 2000;
+        while (short_lived.size() > peak) { pool.deallocate(short_lived.front()); short_lived.pop_front(); }
+    }
+    for (Order* p : short_lived) pool.deallocate(p);
+
+    const long before = rss_kib() - base;
+    const PoolStats st_before = pool.stats();
+    const std::size_t released = pool.trim();
+    const long after = rss_kib() - base;
+    const PoolStats st_after = pool.stats();
+
+    std::printf("%s live=%zu released=%-2zu segs=%zu rss %ld KiB -> %ld KiB, density %.1f%% -> %.1f%%\n",
+                hints ? "hints:   " : "no hints:", pool.live(), released, st_after.segments, before, after,
+                100.0 * st_before.live / st_before.capacity, 100.0 * st_after.live / st_after.capacity);
+}
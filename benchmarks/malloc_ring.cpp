@@ -0,0 +1,47 @@
+// SegmentedMalloc 与 glibc malloc 的对比：每线程 4096 个存活块的环，随机 16-512 字节，
+// 总共 2000 万次 malloc/free。不链接 SegmentedMalloc，用 LD_PRELOAD 切换分配器：
+// Comparison of SegmentedMalloc with glibc malloc: a ring of 4096 live blocks per thread, random
+// 16-512 byte sizes, 20M malloc/free pairs in total. Not linked against SegmentedMalloc; switch
+// allocators with LD_PRELOAD:
+//
+//   g++ -O2 -std=c++20 benchmarks/malloc_ring.cpp -o malloc_ring -lpthread
+//   ./malloc_ring 1 && ./malloc_ring 4
+//   LD_PRELOAD=./libsegmalloc.so ./malloc_ring 1 && LD_PRELOAD=./libsegmalloc.so ./malloc_ring 4
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static void ring(std::size_t pairs, unsigned seed) {
+    constexpr std::size_t live = 4096;
+    void* blocks[live] = {};
+    unsigned x = seed;
+    for (std::size_t i = 0; i < pairs; ++i) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        const std::size_t size = 16 + x % 497;
+        void*& slot = blocks[i % live];
+        std::free(slot);
+        slot = std::malloc(size);
+        static_cast<volatile char*>(slot)[0] = 1;
+    }
+    for (void* p : blocks) std::free(p);
+}
+
+int main(int argc, char** argv) {
+    const unsigned threads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 1;
+    constexpr std::size_t total = 20000000;
+    const char* preload = std::getenv("LD_PRELOAD");
+    const char* name = preload && std::strstr(preload, "segmalloc") ? "SegmentedMalloc:" : "glibc malloc:   ";
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) workers.emplace_back(ring, total / threads, 2463534242u + t);
+    for (auto& w : workers) w.join();
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::printf("%s  %u thread%s20M malloc/free pairs took %lld microseconds\n", name, threads,
+                threads == 1 ? ",  " : "s, ", static_cast<long long>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()));
+}
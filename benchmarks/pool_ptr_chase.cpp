@@ -0,0 +1,44 @@
+// pool_ptr 与裸指针的链表追逐：200 万节点按随机顺序串成链表，各走一遍，
+// 以缓存未命中为主，差值是编号到地址的换算
+// pool_ptr against raw pointers chasing a list: 2M nodes linked in shuffled order, walked once
+// each; cache misses dominate and the difference is the index-to-address translation
+//
+//   g++ -O2 -std=c++20 -I. benchmarks/pool_ptr_chase.cpp -o pool_ptr_chase
+#include "SegmentedObjectPool.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+struct Node { long v; pool_ptr<Node> next; };
+struct RawNode { long v; RawNode* next; };
+
+constexpr long nodes = 2000000;
+
+int main() {
+    using ms = std::chrono::duration<double, std::milli>;
+    auto& pool = SegmentedObjectPool<Node>::instance();
+    std::vector<Node*> all;
+    all.reserve(nodes);
+    for (long i = 0; i < nodes; ++i) all.push_back(pool.allocate(Node{i, {}}));
+    std::vector<RawNode> raw(nodes);
+
+    std::vector<long> order(nodes);
+    for (long i = 0; i < nodes; ++i) order[i] = raw[i].v = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+    for (long i = 0; i + 1 < nodes; ++i) {
+        all[order[i]]->next = pool_ptr<Node>(all[order[i + 1]]);
+        raw[order[i]].next = &raw[order[i + 1]];
+    }
+    raw[order[nodes - 1]].next = nullptr;
+
+    auto t0 = std::chrono::steady_clock::now();
+    long a = 0;
+    for (pool_ptr<Node> p(all[order[0]]); p; p = p->next) a += p->v;
+    auto t1 = std::chrono::steady_clock::now();
+    long b = 0;
+    for (RawNode* p = &raw[order[0]]; p; p = p->next) b += p->v;
+    auto t2 = std::chrono::steady_clock::now();
+    if (a != b) std::puts("mismatch");
+
+    std::printf("pool_ptr %.0f ms\nraw      %.0f ms\n", ms(t1 - t0).count(), ms(t2 - t1).count());
+}
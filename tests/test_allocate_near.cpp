@@ -0,0 +1,32 @@
+// 就近分配不让空闲栈无限增长 / allocate_near must not grow the free stack without bound
+// g++ -std=c++20 -I. tests/test_allocate_near.cpp -o test_allocate_near && ./test_allocate_near
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <set>
+
+struct Fill { long order; long qty; char pad[48]; };
+
+int main() {
+    SegmentedObjectPool<Fill> pool;
+    std::vector<Fill*> v;
+    for (int i = 0; i < 200; ++i) v.push_back(pool.allocate(Fill{i, 1, {}}));
+    for (int i = 0; i < 200; i += 2) pool.deallocate(v[i]);
+
+    // 冻结后空闲栈不能再扩容，过期条目堆积会触发断言 / After freeze the free stack may not grow; piled-up stale entries would trip the assert
+    pool.freeze();
+    for (int i = 0; i < 100000; ++i) {
+        Fill* f = pool.allocate_near(v[1], Fill{i, 2, {}});
+        assert(f);
+        pool.deallocate(f);
+    }
+    pool.thaw();
+
+    // 每个空闲槽位只被分出去一次 / Every free slot is handed out exactly once
+    std::set<Fill*> seen(v.begin(), v.end());
+    for (int i = 0; i < 200; i += 2) seen.erase(v[i]);
+    const std::size_t free_slots = pool.capacity_total() - pool.live();
+    for (std::size_t i = 0; i < free_slots; ++i) assert(seen.insert(pool.allocate(Fill{-1, 0, {}})).second);
+    assert(pool.live() == pool.capacity_total());
+    std::puts("test_allocate_near ok");
+}
@@ -0,0 +1,155 @@
+// 增量检查点 / Incremental checkpoints
+// g++ -std=c++20 -I. tests/test_checkpoint.cpp -o test_checkpoint && ./test_checkpoint
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+struct Acc { long id; long balance; };
+
+static long sum(SegmentedObjectPool<Acc>& pool) {
+    long s = 0;
+    pool.for_each([&](Acc& a) { s += a.balance; });
+    return s;
+}
+
+// 基准之后新分配的对象必须出现在增量里 / Objects allocated after the base must appear in the delta
+static void allocation_between_base_and_delta() {
+    SegmentedObjectPool<Acc> pool;
+    pool.enable_dirty_tracking();
+    pool.allocate(Acc{1, 10});
+    std::stringstream base, delta;
+    assert(pool.write_checkpoint(base, true));
+    pool.allocate(Acc{2, 20});
+    assert(pool.write_checkpoint(delta));
+
+    SegmentedObjectPool<Acc> copy;
+    assert(copy.restore_checkpoint(base));
+    assert(copy.restore_checkpoint(delta));
+    assert(copy.live() == 2 && sum(copy) == 30);
+}
+
+// 增量中的回收与修改 / Deallocations and in-place writes in a delta
+static void deallocation_and_touch() {
+    SegmentedObjectPool<Acc> pool;
+    pool.enable_dirty_tracking();
+    std::vector<Acc*> v;
+    for (long i = 0; i < 10000; ++i) v.push_back(pool.allocate(Acc{i, 1}));
+    std::stringstream base, delta;
+    assert(pool.write_checkpoint(base, true));
+    pool.deallocate(v[5]);
+    v[9000]->balance = 100;
+    pool.touch(v[9000]);
+    assert(pool.write_checkpoint(delta));
+
+    SegmentedObjectPool<Acc> copy;
+    assert(copy.restore_checkpoint(base) && copy.restore_checkpoint(delta));
+    assert(copy.live() == 9999 && sum(copy) == 9998 + 100);
+}
+
+#if defined(__linux__)
+// 增量恢复到已压缩的冷段上，恢复的页面不能被旧的压缩内容盖掉
+// A delta restored over a compressed cold segment; stale compressed contents must not overwrite it
+static void delta_over_cold_segment() {
+    SegmentedObjectPool<Acc> pool;
+    pool.enable_dirty_tracking();
+    std::vector<Acc*> v;
+    for (long i = 0; i < 10000; ++i) v.push_back(pool.allocate(Acc{i, 1}));
+    std::stringstream base, delta;
+    assert(pool.write_checkpoint(base, true));
+    v[42]->balance = 500;
+    pool.touch(v[42]);
+    assert(pool.write_checkpoint(delta));
+
+    SegmentedObjectPool<Acc> copy;
+    copy.enable_cold_tier(std::chrono::nanoseconds(0));
+    assert(copy.restore_checkpoint(base));
+    copy.compress_cold();
+    copy.compress_cold();
+    assert(copy.cold_segments() > 0);
+    assert(copy.restore_checkpoint(delta));
+    assert(copy.cold_segments() == 0);
+    assert(copy.live() == 10000 && sum(copy) == 9999 + 500);
+}
+#endif
+
+// 重排交换会改代数，增量必须带上旁路表，旧句柄在副本里同样失效
+// Reorder swaps bump generations, so the delta must carry the side table and old handles lapse in the copy too
+static void reorder_generations_in_delta() {
+    SegmentedObjectPool<Acc> pool;
+    pool.enable_dirty_tracking();
+    std::vector<SlotHandle> hs;
+    for (long i = 0; i < 100; ++i) hs.push_back(pool.handle_of(pool.allocate(Acc{100 - i, 1})));
+    std::stringstream base, delta;
+    assert(pool.write_checkpoint(base, true));
+    {
+        auto job = pool.reorder([](const Acc& a) { return a.id; });
+        while (!job.step(64)) {}
+    }
+    assert(pool.write_checkpoint(delta));
+
+    SegmentedObjectPool<Acc> copy;
+    assert(copy.restore_checkpoint(base) && copy.restore_checkpoint(delta));
+    for (SlotHandle h : hs) assert((pool.resolve(h) == nullptr) == (copy.resolve(h) == nullptr));
+    assert(!copy.resolve(hs[0]));
+}
+
+// 损坏的检查点：段记录有误时池保持原样，页面部分有误时池被清空
+// Corrupt checkpoints: bad segment records leave the pool as it was, bad pages leave it cleared
+static void rejects_corrupt_checkpoints() {
+    SegmentedObjectPool<Acc> pool;
+    for (long i = 0; i < 100; ++i) pool.allocate(Acc{i, 1});
+    std::stringstream out;
+    assert(pool.write_checkpoint(out, true));
+    const std::string good = out.str();
+
+    // 头部 6 个 uint64，随后第一条段记录以容量开头 / Six uint64 of header, then the first record starting with its capacity
+    auto patched = [&](std::size_t offset, std::uint64_t value) {
+        std::string bad = good;
+        std::memcpy(bad.data() + offset, &value, sizeof(value));
+        return bad;
+    };
+    const std::size_t segments_at = 5 * 8, capacity_at = 6 * 8;
+    std::uint64_t cap;
+    std::memcpy(&cap, good.data() + capacity_at, sizeof(cap));
+    const std::size_t first_page_at = 6 * 8 + 32 + (cap + 63) / 64 * 8 + cap * 4;
+
+    SegmentedObjectPool<Acc> copy;
+    copy.allocate(Acc{7, 7});
+    for (auto [offset, value] : {std::pair<std::size_t, std::uint64_t>{segments_at, ~std::uint64_t(0) >> 4},
+                                 {capacity_at, ~std::uint64_t(0) >> 4},
+                                 {capacity_at, 3}}) {
+        std::stringstream in(patched(offset, value));
+        assert(!copy.restore_checkpoint(in));
+        assert(copy.live() == 1 && sum(copy) == 7);
+    }
+
+    std::stringstream bad_page(patched(first_page_at + 8, std::uint64_t(1) << 40));
+    assert(!copy.restore_checkpoint(bad_page));
+    assert(copy.live() == 0);
+
+    std::stringstream truncated(good.substr(0, good.size() - 100));
+    assert(!copy.restore_checkpoint(truncated));
+    assert(copy.live() == 0);
+
+    std::stringstream in(good);
+    assert(copy.restore_checkpoint(in));
+    assert(copy.live() == 100 && sum(copy) == 100);
+}
+
+// 会解压冷段的成员不能在 const 池上调用 / Members that may decompress cold segments are not callable on a const pool
+template <class Pool>
+concept const_resolve = requires(const Pool& p, SlotHandle h) { p.resolve(h); };
+static_assert(!const_resolve<SegmentedObjectPool<Acc>>);
+
+int main() {
+    allocation_between_base_and_delta();
+    deallocation_and_touch();
+    reorder_generations_in_delta();
+    rejects_corrupt_checkpoints();
+#if defined(__linux__)
+    delta_over_cold_segment();
+#endif
+    std::puts("test_checkpoint ok");
+}
@@ -0,0 +1,117 @@
+// 冷段压缩 / Cold-segment compression
+// g++ -std=c++20 -I. tests/test_cold_tier.cpp -o test_cold_tier && ./test_cold_tier
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <random>
+
+struct Order { long id; int qty; char tag[52]; };
+
+static Order make_order(long i) {
+    Order o{i, static_cast<int>(i % 100), {}};
+    std::snprintf(o.tag, sizeof(o.tag), "ORD-%08ld", i % 5000);
+    return o;
+}
+
+static bool same(const Order& a, const Order& b) { return std::memcmp(&a, &b, sizeof(Order)) == 0; }
+
+// 让所有段变冷：第一轮只记录空闲起点 / Make every segment cold; the first sweep only starts the idle clocks
+static std::size_t freeze_all(SegmentedObjectPool<Order>& pool) {
+    pool.compress_cold();
+    return pool.compress_cold();
+}
+
+static void codec_round_trip() {
+    std::mt19937 rng(1);
+    for (int it = 0; it < 300; ++it) {
+        std::vector<std::byte> in(rng() % 20000), out, back(in.size());
+        for (std::size_t k = 0; k < in.size(); ++k)
+            in[k] = std::byte(it % 3 == 0 ? rng() : it % 3 == 1 ? rng() % 4 : k % 97);
+        detail::lz_compress(in.data(), in.size(), out);
+        assert(detail::lz_decompress(out.data(), out.size(), back.data(), back.size()) && back == in);
+        if (!out.empty()) {   // 截断的输入不能越界 / Truncated input must stay in bounds
+            out.pop_back();
+            (void)detail::lz_decompress(out.data(), out.size(), back.data(), back.size());
+        }
+    }
+}
+
+// 压缩再解压后每个字节不变 / Every byte survives compression and decompression
+static void compress_and_warm_preserve_bytes() {
+    SegmentedObjectPool<Order> pool;
+    std::vector<SlotHandle> hs;
+    for (long i = 0; i < 20000; ++i) hs.push_back(pool.handle_of(pool.allocate(make_order(i))));
+    pool.enable_cold_tier(std::chrono::nanoseconds(0));
+    const std::size_t n = freeze_all(pool);
+    assert(n > 1 && pool.cold_segments() == n && pool.cold_bytes() < pool.capacity_total() * pool.slot_size() / 2);
+
+    const Order* o = pool.resolve(hs[12345]);     // 只解压这一段 / Only this segment is decompressed
+    assert(o && same(*o, make_order(12345)) && pool.cold_segments() == n - 1);
+    long count = 0;
+    pool.for_each([&](Order& x) { assert(same(x, make_order(x.id))); ++count; });
+    assert(count == 20000 && pool.cold_segments() == 0);
+
+    freeze_all(pool);
+    Order* fresh = pool.allocate(make_order(-1));   // 分配也会解压 / Allocation warms as well
+    assert(same(*fresh, make_order(-1)));
+    for (long i = 0; i < 20000; i += 97) assert(same(*pool.resolve(hs[i]), make_order(i)));
+}
+
+// deallocate_raw 先解压所在段，段内其他对象不受影响 / deallocate_raw warms its segment, leaving neighbours intact
+static void deallocate_raw_warms() {
+    SegmentedObjectPool<Order> pool;
+    std::vector<Order*> raw;
+    for (long i = 0; i < 5000; ++i) raw.push_back(::new (pool.allocate_raw()) Order(make_order(i)));
+    const SlotHandle neighbour = pool.handle_of(raw[1]);
+    pool.enable_cold_tier(std::chrono::nanoseconds(0));
+    const std::size_t n = freeze_all(pool);
+    assert(n > 0);
+    pool.deallocate_raw(raw[0]);
+    assert(pool.cold_segments() == n - 1 && pool.live() == 4999);
+    assert(same(*pool.resolve(neighbour), make_order(1)));
+}
+
+// 写保护与 touch 在写入前解压，写入不会被随后的解压覆盖
+// write_guard and touch decompress first, so a write is not overwritten by a later decompression
+static void writers_warm_first() {
+    SegmentedObjectPool<Order> pool;
+    pool.enable_seqlock();
+    pool.enable_dirty_tracking();
+    std::vector<SlotHandle> hs;
+    for (long i = 0; i < 5000; ++i) hs.push_back(pool.handle_of(pool.allocate(make_order(i))));
+    Order* a = pool.resolve(hs[10]);
+    Order* b = pool.resolve(hs[4000]);
+    pool.enable_cold_tier(std::chrono::nanoseconds(0));
+    const std::size_t n = freeze_all(pool);
+
+    { auto g = pool.write_guard(a); a->qty = -7; }
+    assert(pool.cold_segments() == n - 1);
+    pool.touch(b);
+    b->qty = -8;
+    assert(pool.resolve(hs[10])->qty == -7 && pool.resolve(hs[4000])->qty == -8);
+    Order out{};
+    assert(pool.seq_ref(hs[10]).read([&](const Order& o) { out = o; }) && out.qty == -7);
+}
+
+// 重排任务两步之间段变冷，交换仍读到原始对象 / Segments going cold between reorder steps still swap the real objects
+static void reorder_across_sweeps() {
+    SegmentedObjectPool<Order> pool;
+    for (long i = 0; i < 5000; ++i) pool.allocate(make_order(4999 - i));
+    pool.enable_cold_tier(std::chrono::nanoseconds(0));
+    {
+        auto job = pool.reorder([](const Order& o) { return o.id; });
+        while (!job.step(200)) freeze_all(pool);
+    }
+    long expect = 0;
+    pool.for_each([&](Order& o) { assert(same(o, make_order(expect))); ++expect; });
+    assert(expect == 5000);
+}
+
+int main() {
+    codec_round_trip();
+    compress_and_warm_preserve_bytes();
+    deallocate_raw_warms();
+    writers_warm_first();
+    reorder_across_sweeps();
+    std::puts("test_cold_tier ok");
+}
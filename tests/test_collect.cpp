@@ -0,0 +1,69 @@
+// 标记-清除回收 / Mark-sweep collection
+// g++ -std=c++20 -I. tests/test_collect.cpp -o test_collect && ./test_collect
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+
+struct Node {
+    long id;
+    pool_ptr<Node> next;
+    template <class V> void trace(V& v) const { v(next); }
+};
+
+// 冷段中的可达对象不能被清除 / Reachable objects in cold segments must survive the sweep
+static void reachable_chain_in_cold_segments() {
+#if defined(__linux__)
+    auto& pool = SegmentedObjectPool<Node>::instance();
+    pool.enable_cold_tier(std::chrono::nanoseconds(0));
+    pool_ptr<Node> head;
+    for (long i = 0; i < 5000; ++i) head = pool_ptr<Node>(pool.allocate(Node{i, head}));
+    pool.add_root(head.get());
+    pool.compress_cold();
+    pool.compress_cold();
+    assert(pool.cold_segments() > 0);
+    assert(pool.collect() == 0);
+    long n = 0;
+    for (auto p = head; p; p = p->next) assert(p->id == 4999 - n++);
+    assert(n == 5000 && pool.live() == 5000);
+    pool.remove_root(head.get());
+    assert(pool.collect() == 5000 && pool.live() == 0);
+#endif
+}
+
+// 只有仍在信号栈上的保留对象是根 / Only reserve objects still on the signal stack are roots
+static void handed_out_reserve_objects_are_collectable() {
+    SegmentedObjectPool<Node> pool;
+    assert(pool.reserve_for_signals(4, Node{}) == 4);
+    Node* a = pool.signal_allocate();
+    Node* b = pool.signal_allocate();
+    assert(a && b);
+    assert(pool.collect() == 2);
+    assert(pool.live() == 2);
+    assert(pool.signal_allocate() && pool.signal_allocate() && !pool.signal_allocate());
+}
+
+// 清除的对象与 recycle() 一样先 reset / Swept objects are reset first, as recycle() does
+struct Conn : PooledObject<Conn> {
+    static inline int resets = 0;
+    long id;
+    explicit Conn(long i) : id(i) {}
+    void reset() override { ++resets; }
+};
+
+static void sweep_resets_objects() {
+    auto& pool = SegmentedObjectPool<Conn>::instance();
+    Conn* root = Conn::create(0L);
+    Conn* dead = Conn::create(1L);
+    pool.add_root(root);
+    assert(pool.collect() == 1);
+    assert(Conn::resets == 1 && dead->is_recycled() && !root->is_recycled());
+    pool.remove_root(root);
+    assert(pool.collect() == 1 && Conn::resets == 2);
+}
+
+int main() {
+    reachable_chain_in_cold_segments();
+    handed_out_reserve_objects_are_collectable();
+    sweep_resets_objects();
+    std::puts("test_collect ok");
+}
@@ -0,0 +1,141 @@
+// 分段页面上的 ECS / ECS storage on segmented pages
+// g++ -std=c++20 -I. tests/test_ecs.cpp -o test_ecs && ./test_ecs
+#undef NDEBUG
+#include "SegmentedECS.hpp"
+#include <cstdio>
+#include <set>
+
+struct Pos { float x, y, z; };
+struct Vel { float x, y, z; };
+
+// 统计存活实例，检查迁移与销毁不泄漏也不重复析构 / Counts live instances so moves and destroys neither leak nor double-destroy
+struct Tag {
+    static inline int live = 0;
+    long id;
+    explicit Tag(long i) : id(i) { ++live; }
+    Tag(Tag&& o) noexcept : id(o.id) { ++live; }
+    ~Tag() { --live; }
+};
+
+// 行宽 29 字节，1 页块时触发退回布局，组件列长度不是 4 的倍数 / 29-byte rows force the fallback layout with 1-page chunks; the component column length is not a multiple of 4
+struct Odd { char bytes[21]; };
+struct alignas(16) Wide { double v[2]; };
+
+static void spawn_and_destroy() {
+    EcsWorld world;
+    const Entity a = world.create(Pos{1, 2, 3});
+    const Entity b = world.create(Pos{4, 5, 6}, Vel{1, 0, 0});
+    assert(world.size() == 2 && world.alive(a) && world.alive(b));
+    assert(world.get<Pos>(a)->y == 2 && world.get<Vel>(a) == nullptr);
+    assert(world.has<Vel>(b) && world.get<Pos>(b)->z == 6);
+
+    world.destroy(a);
+    assert(!world.alive(a) && world.get<Pos>(a) == nullptr && world.size() == 1);
+    const Entity c = world.create(Pos{7, 8, 9});
+    assert(c.index == a.index && c.gen != a.gen);   // 编号复用，旧句柄仍然失效 / Index reused, old handle still lapsed
+    assert(!world.alive(a) && world.get<Pos>(c)->x == 7);
+    world.destroy(a);                              // 过期句柄不影响新实体 / A stale handle leaves the new entity alone
+    assert(world.alive(c));
+}
+
+static void add_and_remove_move_archetypes() {
+    {
+        EcsWorld world;
+        const Entity e = world.create(Pos{1, 2, 3}, Tag{7});
+        const Entity other = world.create(Pos{9, 9, 9}, Tag{8});
+        assert(world.archetype_count() == 1);
+
+        world.add(e, Vel{4, 5, 6});
+        assert(world.archetype_count() == 2 && Tag::live == 2);
+        assert(world.get<Pos>(e)->z == 3 && world.get<Vel>(e)->x == 4 && world.get<Tag>(e)->id == 7);
+        assert(world.get<Tag>(other)->id == 8);    // 源原型中的空洞被补上 / The hole in the source archetype was filled
+
+        world.add(e, Vel{0, 0, 1});                // 已有组件时原地赋值 / Assigns in place when present
+        assert(world.archetype_count() == 2 && world.get<Vel>(e)->z == 1);
+
+        world.remove<Tag>(e);
+        assert(!world.has<Tag>(e) && Tag::live == 1);
+        assert(world.get<Pos>(e)->x == 1 && world.get<Vel>(e)->z == 1);
+        world.remove<Tag>(e);                      // 没有该组件时什么也不做 / No-op without the component
+        assert(world.archetype_count() == 3 && (world.query<Pos, Vel>().count() == 1));
+    }
+    assert(Tag::live == 0);
+}
+
+static void chunk_overflow() {
+    EcsWorld world;
+    const std::size_t cap = world.chunk_capacity<Pos>();
+    std::vector<Entity> es;
+    for (std::size_t i = 0; i <= cap; ++i) es.push_back(world.create(Pos{static_cast<float>(i), 0, 0}));
+    assert(world.chunk_count() == 2);
+    for (std::size_t i = 0; i <= cap; ++i) assert(world.get<Pos>(es[i])->x == static_cast<float>(i));
+
+    std::size_t chunks = 0, rows = 0;
+    world.query<Pos>().each_chunk([&](std::size_t n, const Entity*, Pos*) { ++chunks; rows += n; });
+    assert(chunks == 2 && rows == cap + 1);
+
+    world.destroy(es[0]);                          // 末块的唯一一行移入第一块 / The last chunk's only row moves into the first
+    assert(world.chunk_count() == 1);
+    assert(world.get<Pos>(es[cap])->x == static_cast<float>(cap));
+}
+
+static void iteration_after_swap_remove() {
+    EcsWorld world;
+    std::vector<Entity> es;
+    for (int i = 0; i < 3000; ++i) es.push_back(world.create(Pos{static_cast<float>(i), 0, 0}, Vel{1, 0, 0}));
+    std::set<int> expect;
+    for (int i = 0; i < 3000; ++i) {
+        if (i % 3 == 0) world.destroy(es[i]);
+        else expect.insert(i);
+    }
+
+    std::set<int> seen;
+    world.each<Pos, Vel>([&](Entity e, Pos& p, Vel& v) {
+        assert(world.get<Pos>(e) == &p && v.x == 1);
+        assert(seen.insert(static_cast<int>(p.x)).second);
+    });
+    assert(seen == expect);
+
+    // 遍历中的销毁延后到 apply / Destroys during iteration wait for apply
+    {
+        EcsWorld::Commands cmd(world);
+        world.each<Pos>([&](Entity e, Pos& p) { if (static_cast<int>(p.x) % 2) cmd.destroy(e); });
+        assert(world.size() == expect.size());
+    }
+    world.each<Pos>([](Pos& p) { assert(static_cast<int>(p.x) % 2 == 0); });
+    assert(world.size() == 1000);
+}
+
+static void fallback_layout_alignment() {
+    EcsWorld world(1);
+    const std::size_t page = detail::os_page_size();
+    const std::size_t row = sizeof(Entity) + sizeof(Odd);
+    assert(detail::min_segment_pages(page, row, 1) > 16);   // 确实走退回布局 / Really takes the fallback
+    const std::size_t cap = world.chunk_capacity<Odd>();
+    assert(cap == page / row && cap * sizeof(Odd) % alignof(Entity) != 0);
+
+    for (std::size_t i = 0; i < 2 * cap; ++i) world.create(Odd{{static_cast<char>(i)}});
+    world.query<Odd>().each_chunk([&](std::size_t n, const Entity* ids, Odd* odd) {
+        const auto base = reinterpret_cast<std::uintptr_t>(odd);
+        const auto id = reinterpret_cast<std::uintptr_t>(ids);
+        assert(base % page == 0 && id % alignof(Entity) == 0);
+        assert(id + cap * sizeof(Entity) <= base + page);   // 实体列不越过块尾 / The entity column stays inside the chunk
+        for (std::size_t i = 0; i < n; ++i) assert(world.get<Odd>(ids[i]) == &odd[i]);
+    });
+
+    for (int i = 0; i < 1000; ++i) world.create(Odd{}, Wide{{1.0, 2.0}});
+    world.query<Wide, Odd>().each_chunk([](std::size_t n, const Entity* ids, Wide* w, Odd*) {
+        assert(reinterpret_cast<std::uintptr_t>(w) % alignof(Wide) == 0);
+        assert(reinterpret_cast<std::uintptr_t>(ids) % alignof(Entity) == 0);
+        for (std::size_t i = 0; i < n; ++i) assert(w[i].v[1] == 2.0);
+    });
+}
+
+int main() {
+    spawn_and_destroy();
+    add_and_remove_move_archetypes();
+    chunk_overflow();
+    iteration_after_swap_remove();
+    fallback_layout_alignment();
+    std::puts("test_ecs ok");
+}
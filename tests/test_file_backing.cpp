@@ -0,0 +1,66 @@
+// 文件后备 / File-backed pools
+// g++ -std=c++20 -I. tests/test_file_backing.cpp -o test_file_backing && ./test_file_backing
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+
+struct Order { long id; long qty; };
+
+static bool dir_is_empty(const char* dir) {
+    DIR* d = ::opendir(dir);
+    assert(d);
+    int entries = 0;
+    while (::readdir(d)) ++entries;
+    ::closedir(d);
+    return entries == 2;   // "." 和 ".." / "." and ".."
+}
+
+// 写入、回收、再分配后内容不变，交换文件没有名字 / Data survives free and reuse; the swap file has no name
+static void round_trip(const char* dir) {
+    {
+        SegmentedObjectPool<Order> pool(0, 2.0);
+        assert(pool.open_swap_file(dir));
+        std::vector<Order*> objs;
+        for (long i = 0; i < 200000; ++i) objs.push_back(pool.allocate(Order{i, i * 3}));
+        assert(dir_is_empty(dir));
+        for (long i = 0; i < 200000; i += 2) pool.deallocate(objs[i]);
+
+        pool.advise_sequential();
+        long count = 0;
+        pool.for_each([&](Order& o) { assert(o.id % 2 == 1 && o.qty == o.id * 3); ++count; });
+        pool.advise_sequential(false);
+        assert(count == 100000);
+
+        pool.will_need(objs[1], 1000);
+        for (long i = 0; i < 200000; i += 2) objs[i] = pool.allocate(Order{-i, i});
+        for (long i = 0; i < 200000; ++i)
+            assert(i % 2 ? objs[i]->id == i && objs[i]->qty == i * 3 : objs[i]->id == -i && objs[i]->qty == i);
+
+        auto child = pool.fork();
+        long seen = 0;
+        child->for_each([&](Order&) { ++seen; });
+        assert(seen == 200000);
+    }
+    assert(dir_is_empty(dir));
+}
+
+// 目录不存在时打开失败，池仍可在堆上使用 / A missing directory fails and the pool stays on the heap
+static void rejects_missing_directory() {
+    SegmentedObjectPool<Order> pool;
+    assert(!pool.open_swap_file("/nonexistent-segmented-pool-dir"));
+    Order* o = pool.allocate(Order{1, 2});
+    assert(o->qty == 2);
+    pool.deallocate(o);
+}
+
+int main() {
+    char dir[] = "/tmp/segpool-XXXXXX";
+    assert(::mkdtemp(dir));
+    round_trip(dir);
+    rejects_missing_directory();
+    ::rmdir(dir);
+    std::puts("test_file_backing ok");
+}
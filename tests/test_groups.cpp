@@ -0,0 +1,114 @@
+// release_group 只释放现存的组；越界的段组编号分配失败 / release_group releases live groups only; out-of-range set ids fail to allocate
+// g++ -std=c++20 -I. tests/test_groups.cpp -o test_groups && ./test_groups
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+
+struct Order { long id; };
+
+static void rejects_non_groups() {
+    SegmentedObjectPool<Order> pool;
+    Order* a = pool.allocate(Order{1});
+    Order* b = pool.allocate(hint_short_lived, Order{2});
+    Order* c = pool.allocate(hint_long_lived, Order{3});
+    Order* d = pool.allocate(AllocHint{7}, Order{4});
+    assert(pool.release_group(hint_default) == 0);
+    assert(pool.release_group(hint_short_lived) == 0);
+    assert(pool.release_group(hint_long_lived) == 0);
+    assert(pool.release_group(AllocHint{7}) == 0);     // 自定义段组不是组 / A user-defined set is not a group
+    assert(pool.release_group(AllocHint{1000}) == 0);
+    assert(pool.live() == 4);
+    assert(a->id == 1 && b->id == 2 && c->id == 3 && d->id == 4);
+
+    // 这些编号没有进入复用列表 / None of those ids was queued for reuse
+    const AllocHint g1 = pool.create_group();
+    const AllocHint g2 = pool.create_group();
+    assert(g1.set >= max_hint_sets && g2.set >= max_hint_sets && g1.set != g2.set);
+}
+
+static void rejects_out_of_range_sets() {
+    SegmentedObjectPool<Order> pool;
+    assert(pool.allocate(AllocHint{max_hint_sets - 1}, Order{1}));
+    assert(!pool.allocate(AllocHint{max_hint_sets + 1000}, Order{2}));
+    assert(!pool.allocate(AllocHint{0xFFFFFFFFu}, Order{3}));   // 不能回绕成 0 / Must not wrap to 0
+    assert(pool.reserve(10, AllocHint{0xFFFFFFFFu}) == 0);
+    assert(pool.live() == 1);
+}
+
+static void release_once() {
+    SegmentedObjectPool<Order> pool;
+    const AllocHint g = pool.create_group();
+    for (long i = 0; i < 100; ++i) pool.allocate(g, Order{i});
+    assert(pool.release_group(g) == 100);
+    assert(pool.release_group(g) == 0);   // 重复释放 / Released twice
+
+    const AllocHint again = pool.create_group();
+    assert(again.set == g.set);           // 编号复用了一次 / The id is reused exactly once
+    assert(pool.create_group().set != g.set);
+    pool.allocate(again, Order{1});
+    assert(pool.release_group(again) == 1);
+}
+
+// 组与自定义段组互不干扰，旧提示在组释放和编号复用后失效
+// Groups and user-defined sets never collide, and old hints lapse once a group is released and its id reused
+static void stale_group_hints() {
+    SegmentedObjectPool<Order> pool;
+    Order* user = pool.allocate(AllocHint{3}, Order{3});
+    const AllocHint g = pool.create_group();
+    assert(g.set >= max_hint_sets);
+    pool.allocate(g, Order{1});
+    assert(pool.release_group(g) == 1);
+    assert(pool.live() == 1 && user->id == 3);
+
+    assert(!pool.allocate(g, Order{2}));             // 释放后的提示不能再分配 / A released hint cannot allocate
+    const AllocHint fresh = pool.create_group();
+    assert(fresh.set == g.set && fresh.gen != g.gen);
+    Order* kept = pool.allocate(fresh, Order{4});
+    assert(!pool.allocate(g, Order{5}));
+    assert(pool.release_group(g) == 0);              // 不会销毁新组的对象 / Must not destroy the new group's objects
+    std::size_t seen = 0;
+    pool.for_each(g, [&](Order&) { ++seen; });
+    assert(seen == 0 && kept->id == 4);
+    assert(pool.release_group(fresh) == 1);
+    assert(pool.live() == 1);
+}
+
+static void groups_survive_clear() {
+    SegmentedObjectPool<Order> pool;
+    const AllocHint g = pool.create_group();
+    pool.allocate(g, Order{1});
+    pool.clear();
+    pool.allocate(g, Order{2});
+    pool.allocate(g, Order{3});
+    assert(pool.release_group(g) == 2);
+    assert(pool.live() == 0);
+}
+
+// 组内对象与 recycle() 一样先 reset / Objects of a group are reset first, as recycle() does
+struct Conn : PooledObject<Conn> {
+    static inline int resets = 0;
+    long id;
+    explicit Conn(long i) : id(i) {}
+    void reset() override { ++resets; }
+};
+
+static void release_resets_objects() {
+    auto& pool = SegmentedObjectPool<Conn>::instance();
+    const AllocHint g = pool.create_group();
+    for (long i = 0; i < 10; ++i) pool.allocate(g, i);
+    Conn* other = Conn::create(99L);
+    assert(pool.release_group(g) == 10);
+    assert(Conn::resets == 10 && !other->is_recycled());
+    other->recycle();
+    assert(Conn::resets == 11);
+}
+
+int main() {
+    rejects_non_groups();
+    rejects_out_of_range_sets();
+    release_once();
+    groups_survive_clear();
+    stale_group_hints();
+    release_resets_objects();
+    std::puts("test_groups ok");
+}
@@ -0,0 +1,70 @@
+// 句柄在段释放、编号复用后失效；事务回滚走 recycle 路径
+// Handles lapse after their segment is released and its indices reused; rollback goes through the recycle path
+// g++ -std=c++20 -I. tests/test_handles.cpp -o test_handles && ./test_handles
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+
+struct Order { long id; };
+
+static void stale_handle_after_release_group() {
+    SegmentedObjectPool<Order> pool;
+    PoolTimerWheel<Order> wheel(pool);
+    AllocHint group = pool.create_group();
+    Order* old = pool.allocate(group, Order{7});
+    const SlotHandle h = pool.handle_of(old);
+    wheel.schedule(old, 10);
+    assert(pool.release_group(group) == 1);
+
+    Order* fresh = pool.allocate(Order{42});
+    assert(pool.handle_of(fresh).index == h.index);   // 编号被复用 / The index is reused
+    assert(pool.resolve(h) == nullptr);
+    assert(wheel.advance(10) == 0);
+    assert(pool.live() == 1 && fresh->id == 42);
+}
+
+static void stale_handle_after_trim_and_clear() {
+    SegmentedObjectPool<Order> pool;
+    std::vector<SlotHandle> hs;
+    for (long i = 0; i < 1000; ++i) hs.push_back(pool.handle_of(pool.allocate(Order{i})));
+    for (auto h : hs) pool.deallocate(pool.resolve(h));
+    pool.trim();
+    for (long i = 0; i < 1000; ++i) pool.allocate(Order{i});
+    for (auto h : hs) assert(!pool.resolve(h));
+
+    hs.clear();
+    for (long i = 0; i < 10; ++i) hs.push_back(pool.handle_of(pool.allocate(Order{i})));
+    pool.clear();
+    for (long i = 0; i < 2000; ++i) pool.allocate(Order{i});
+    for (auto h : hs) assert(!pool.resolve(h));
+}
+
+struct Conn : PooledObject<Conn> {
+    static inline int resets = 0;
+    long id;
+    explicit Conn(long i) : id(i) {}
+    void reset() override { ++resets; }
+};
+
+static void rollback_resets_objects() {
+    auto& pool = SegmentedObjectPool<Conn>::instance();
+    Conn* kept = Conn::create(0L);
+    Conn* a;
+    Conn* b;
+    {
+        auto tx = pool.begin_transaction();
+        a = tx.allocate(1L);
+        b = tx.allocate(2L);
+        tx.rollback();
+    }
+    assert(Conn::resets == 2 && a->is_recycled() && b->is_recycled());
+    assert(pool.live() == 1 && !kept->is_recycled());
+    kept->recycle();
+}
+
+int main() {
+    stale_handle_after_release_group();
+    stale_handle_after_trim_and_clear();
+    rollback_resets_objects();
+    std::puts("test_handles ok");
+}
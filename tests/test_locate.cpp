@@ -0,0 +1,85 @@
+// 指针到段的查找：多段、段释放、清空和 fork 之后都要正确；构造抛异常时槽位要归还
+// Pointer-to-segment lookup across segments, trim, clear and fork; a throwing constructor must give its slot back
+// g++ -std=c++20 -I. tests/test_locate.cpp -o test_locate && ./test_locate
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <stdexcept>
+
+struct Item { long v[5]; };
+
+static void lookup_across_segments() {
+    SegmentedObjectPool<Item> pool(1, 1.0);
+    std::vector<Item*> items;
+    for (long i = 0; i < 20000; ++i) items.push_back(pool.allocate(Item{{i}}));
+    assert(pool.segments() > 5);
+    for (Item* p : items) {
+        assert(pool.contains(p));
+        assert(pool.contains(reinterpret_cast<std::byte*>(p) + sizeof(Item) - 1));
+        assert(!pool.is_recycled(p));
+    }
+    Item local{};
+    auto* foreign = new Item{};
+    assert(!pool.contains(&local) && !pool.contains(foreign));
+    delete foreign;
+
+    for (std::size_t i = 0; i < items.size(); i += 2) pool.deallocate(items[i]);
+    for (std::size_t i = 0; i < items.size(); ++i) assert(pool.is_recycled(items[i]) == (i % 2 == 0));
+
+    // 段整体空闲后被释放，原地址不再属于本池 / Fully free segments are released and their addresses leave the pool
+    for (std::size_t i = 1; i < items.size(); i += 2) pool.deallocate(items[i]);
+    pool.trim();
+    for (long i = 0; i < 100; ++i) assert(pool.contains(pool.allocate(Item{{i}})));
+    std::size_t owned = 0;
+    for (Item* p : items) owned += pool.contains(p);
+    assert(owned <= 100 * 2);
+
+    pool.clear();
+    for (Item* p : items) assert(!pool.contains(p));
+}
+
+struct Fragile {
+    long v;
+    explicit Fragile(long x) : v(x) { if (x < 0) throw std::runtime_error("negative"); }
+};
+
+static void throwing_constructor_releases_slot() {
+    SegmentedObjectPool<Fragile> pool;
+    Fragile* a = pool.allocate(1L);
+    bool threw = false;
+    try { pool.allocate(-1L); } catch (const std::runtime_error&) { threw = true; }
+    assert(threw && pool.live() == 1);
+    std::size_t seen = 0;
+    pool.for_each([&](Fragile& f) { assert(f.v == 1); ++seen; });
+    assert(seen == 1);
+    Fragile* b = pool.allocate(2L);   // 复用那个槽位 / Reuses that slot
+    assert(b != a && b->v == 2 && pool.live() == 2);
+    pool.deallocate(a);
+    pool.deallocate(b);
+    assert(pool.live() == 0);
+}
+
+#if defined(__linux__)
+static void lookup_in_fork() {
+    SegmentedObjectPool<Item> pool(1, 1.0, PoolBacking::memfd);
+    std::vector<Item*> items;
+    for (long i = 0; i < 5000; ++i) items.push_back(pool.allocate(Item{{i}}));
+    auto copy = pool.fork();
+    std::size_t seen = 0;
+    copy->for_each([&](Item& it) {
+        assert(copy->contains(&it) && !pool.contains(&it));
+        ++seen;
+    });
+    assert(seen == items.size());
+    for (Item* p : items) assert(!copy->contains(p));
+}
+#endif
+
+int main() {
+    lookup_across_segments();
+    throwing_constructor_releases_slot();
+#if defined(__linux__)
+    lookup_in_fork();
+#endif
+    std::puts("test_locate ok");
+}
@@ -0,0 +1,93 @@
+// 池内相对指针 / Pool-relative pointers
+// g++ -std=c++20 -I. tests/test_pool_ptr.cpp -o test_pool_ptr && ./test_pool_ptr
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <sstream>
+
+struct Node { long v; pool_ptr<Node> next; };
+
+static_assert(sizeof(pool_ptr<Node>) == 4);
+static_assert(sizeof(Node) == 16);
+static_assert(std::is_trivially_copyable_v<Node>);
+
+static void null_and_comparisons() {
+    pool_ptr<Node> empty, also_empty(nullptr);
+    assert(!empty && empty == nullptr && empty == also_empty && empty.get() == nullptr);
+    assert(empty.index() == SlotHandle::invalid);
+
+    auto& pool = SegmentedObjectPool<Node>::instance();
+    Node* n = pool.allocate(Node{7, {}});
+    pool_ptr<Node> p(n);
+    assert(p && p != nullptr && p.get() == n && p->v == 7 && (*p).v == 7);
+    assert(p.index() == pool.index_of(n) && p.index() == pool.handle_of(n).index);
+    assert(pool_ptr<Node>::from_index(p.index()) == p);
+    pool_ptr<const Node> c(n);
+    assert(c->v == 7 && c.index() == p.index());
+    p.reset();
+    assert(!p);
+    int foreign = 0;
+    assert(pool.index_of(&foreign) == SlotHandle::invalid);
+    pool.deallocate(n);
+}
+
+// 跨多段的链表，沿 pool_ptr 遍历得到原顺序 / A list spanning several segments walks back in order
+static void list_across_segments() {
+    auto& pool = SegmentedObjectPool<Node>::instance();
+    pool_ptr<Node> head;
+    for (long i = 0; i < 50000; ++i) head = pool_ptr<Node>(pool.allocate(Node{i, head}));
+    assert(pool.segments() > 1);
+    long expect = 49999;
+    for (pool_ptr<Node> p = head; p; p = p->next) assert(p->v == expect--);
+    assert(expect == -1);
+    for (pool_ptr<Node> p = head; p;) {
+        pool_ptr<Node> next = p->next;
+        pool.deallocate(p.get());
+        p = next;
+    }
+}
+
+// 其他池的对象用 get(pool) 解引用 / Objects of another pool dereference through get(pool)
+static void other_pool() {
+    SegmentedObjectPool<Node> pool;
+    Node* a = pool.allocate(Node{1, {}});
+    Node* b = pool.allocate(Node{2, pool_ptr<Node>(a, pool)});
+    const pool_ptr<Node> pb(b, pool);
+    assert(pb.get(pool) == b && pb.get(pool)->next.get(pool) == a);
+}
+
+// fork 与检查点恢复后编号仍然有效，指向新地址上的同一对象
+// After fork and checkpoint restore the indices still hold and reach the same objects at new addresses
+static void survives_fork_and_restore() {
+    SegmentedObjectPool<Node> pool(0, 1.0, PoolBacking::memfd);
+    pool.enable_dirty_tracking();
+    pool_ptr<Node> head;
+    for (long i = 0; i < 5000; ++i) head = pool_ptr<Node>(pool.allocate(Node{i, head}), pool);
+
+    auto fork = pool.fork();
+    assert(fork);
+    long count = 0;
+    for (pool_ptr<Node> p = head; p; p = p.get(*fork)->next) {
+        assert(p.get(*fork) != p.get(pool) && p.get(*fork)->v == p.get(pool)->v);
+        ++count;
+    }
+    assert(count == 5000);
+
+    std::stringstream cp;
+    assert(pool.write_checkpoint(cp, true));
+    SegmentedObjectPool<Node> replica;
+    assert(replica.restore_checkpoint(cp));
+    long expect = 4999;
+    for (pool_ptr<Node> p = head; p; p = p.get(replica)->next) {
+        assert(p.get(replica) != p.get(pool) && p.get(replica)->v == expect--);
+    }
+    assert(expect == -1);
+}
+
+int main() {
+    null_and_comparisons();
+    list_across_segments();
+    other_pool();
+    survives_fork_and_restore();
+    std::puts("test_pool_ptr ok");
+}
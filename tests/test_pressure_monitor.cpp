@@ -0,0 +1,94 @@
+// 内存压力监视器 / Memory-pressure monitor
+// g++ -std=c++20 -I. tests/test_pressure_monitor.cpp -o test_pressure_monitor && ./test_pressure_monitor
+#undef NDEBUG
+#include "MemoryPressureMonitor.hpp"
+#include <cstdio>
+
+struct Blob { long id; char pad[56]; };
+
+// 只在等级升高时回收，critical 期间每次采样都回收 / Reclaim on a rise only, and on every sample while critical
+static void reclaims_on_rise_and_while_critical() {
+    FakePressureSource source;
+    MemoryPressureMonitor monitor(source);
+    std::vector<PressureLevel> calls;
+    monitor.add([&](PressureLevel l) { calls.push_back(l); return std::size_t{0}; });
+
+    monitor.poll_once();
+    assert(calls.empty());
+    source.set(PressureLevel::moderate);
+    monitor.poll_once();
+    monitor.poll_once();
+    assert(calls.size() == 1 && calls[0] == PressureLevel::moderate);
+    source.set(PressureLevel::critical);
+    monitor.poll_once();
+    monitor.poll_once();
+    monitor.poll_once();
+    assert(calls.size() == 4 && calls[3] == PressureLevel::critical);
+    source.set(PressureLevel::moderate);
+    monitor.poll_once();
+    assert(calls.size() == 4 && monitor.level() == PressureLevel::moderate);
+    source.set(PressureLevel::none);
+    monitor.poll_once();
+    source.set(PressureLevel::moderate);
+    monitor.poll_once();
+    assert(calls.size() == 5 && monitor.reclaims() == 5);
+}
+
+// 登记的对象池被 trim，返回释放的段数 / A registered pool is trimmed and the released segments are returned
+static void trims_registered_pools() {
+    SegmentedObjectPool<Blob> pool;
+    std::vector<Blob*> objs;
+    for (long i = 0; i < 10000; ++i) objs.push_back(pool.allocate(Blob{i, {}}));
+    for (Blob* b : objs) pool.deallocate(b);
+    const std::size_t before = pool.segments();
+    assert(before > 1);
+
+    FakePressureSource source;
+    MemoryPressureMonitor monitor(source);
+    monitor.add(pool);
+    source.set(PressureLevel::critical);
+    assert(monitor.poll_once() > 0);
+    assert(pool.segments() < before);
+}
+
+// remove 之后不再调用该回收动作 / After remove() the action is no longer called
+static void remove_unregisters() {
+    FakePressureSource source;
+    MemoryPressureMonitor monitor(source);
+    int a = 0, b = 0;
+    const std::size_t ida = monitor.add([&](PressureLevel) { ++a; return std::size_t{0}; });
+    monitor.add([&](PressureLevel) { ++b; return std::size_t{0}; });
+    source.set(PressureLevel::critical);
+    monitor.poll_once();
+    monitor.remove(ida);
+    monitor.poll_once();
+    assert(a == 1 && b == 2);
+}
+
+// 后台线程响应等级变化，stop() 打断等待后立即返回 / The thread reacts to a change and stop() interrupts its wait
+static void background_thread_stops_promptly() {
+    FakePressureSource source;
+    MemoryPressureMonitor monitor(source);
+    std::atomic<int> calls{0};
+    monitor.add([&](PressureLevel) { ++calls; return std::size_t{0}; });
+    monitor.start(std::chrono::hours(1));
+    source.set(PressureLevel::moderate);
+    for (int i = 0; i < 5000 && calls == 0; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    assert(calls == 1);
+
+    const auto t0 = std::chrono::steady_clock::now();
+    monitor.stop();
+    assert(std::chrono::steady_clock::now() - t0 < std::chrono::seconds(5));
+    source.set(PressureLevel::critical);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    assert(calls == 1);
+    monitor.stop();
+}
+
+int main() {
+    reclaims_on_rise_and_while_critical();
+    trims_registered_pools();
+    remove_unregisters();
+    background_thread_stops_promptly();
+    std::puts("test_pressure_monitor ok");
+}
@@ -0,0 +1,75 @@
+// 优先级保留容量 / Priority reserve
+// g++ -std=c++20 -I. tests/test_priority_reserve.cpp -o test_priority_reserve && ./test_priority_reserve
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+
+struct Ack { long id; explicit Ack(long i = 0) : id(i) {} };
+
+// 普通分配止于 max_live 减保留部分，高优先级可以用到 max_live
+// Normal allocation stops short of the reserved part; high priority may go up to max_live
+static void rejects_and_admits_at_the_limits() {
+    SegmentedObjectPool<Ack> pool;
+    pool.set_priority_reserve(100, 0.1);
+    std::vector<Ack*> objs;
+    for (long i = 0; i < 90; ++i) objs.push_back(pool.allocate(i));
+    for (Ack* a : objs) assert(a);
+    assert(pool.allocate(90L) == nullptr && pool.allocate(priority::normal, 90L) == nullptr);
+    assert(pool.live() == 90);
+    for (long i = 90; i < 100; ++i) objs.push_back(pool.allocate(priority::high, i));
+    assert(objs.back() && objs.back()->id == 99 && pool.live() == 100);
+    assert(pool.allocate(priority::high, 100L) == nullptr);
+
+    // 回收后存活数降到普通上限以下，普通分配才恢复 / After frees, normal allocation resumes only once live drops below its limit
+    for (int i = 0; i < 5; ++i) { pool.deallocate(objs.back()); objs.pop_back(); }
+    assert(pool.allocate(0L) == nullptr);
+    for (int i = 0; i < 10; ++i) { pool.deallocate(objs.back()); objs.pop_back(); }
+    assert(pool.live() == 85 && pool.allocate(1L) != nullptr);
+}
+
+// 带提示与就近分配同样受普通上限约束 / Hinted and near allocations obey the normal limit as well
+static void other_paths_obey_the_normal_limit() {
+    SegmentedObjectPool<Ack> pool;
+    pool.set_priority_reserve(10, 0.5);
+    Ack* first = pool.allocate(AllocHint{2}, 0L);
+    for (long i = 1; i < 5; ++i) assert(pool.allocate_near(first, i));
+    assert(pool.allocate(AllocHint{2}, 5L) == nullptr);
+    assert(pool.allocate_near(first, 5L) == nullptr);
+    assert(pool.allocate(priority::high, 5L) != nullptr);
+}
+
+// 比例被限制在 [0, 1] 内；未设置时没有上限 / The fraction is clamped to [0, 1]; no limit unless set
+static void clamps_the_fraction() {
+    SegmentedObjectPool<Ack> pool;
+    for (long i = 0; i < 100000; ++i) assert(pool.allocate(i));
+
+    SegmentedObjectPool<Ack> all_high;
+    all_high.set_priority_reserve(3, 2.0);
+    assert(all_high.allocate(0L) == nullptr);
+    for (long i = 0; i < 3; ++i) assert(all_high.allocate(priority::high, i));
+    assert(all_high.allocate(priority::high, 3L) == nullptr);
+
+    SegmentedObjectPool<Ack> no_reserve;
+    no_reserve.set_priority_reserve(3, -1.0);
+    for (long i = 0; i < 3; ++i) assert(no_reserve.allocate(i));
+    assert(no_reserve.allocate(3L) == nullptr && no_reserve.allocate(priority::high, 3L) == nullptr);
+}
+
+// 上限低于当前存活数时两种分配都拒绝，直到回收到上限以下 / A limit below the live count rejects both until enough objects are freed
+static void limit_below_live_count() {
+    SegmentedObjectPool<Ack> pool;
+    std::vector<Ack*> objs;
+    for (long i = 0; i < 20; ++i) objs.push_back(pool.allocate(i));
+    pool.set_priority_reserve(10, 0.2);
+    assert(pool.allocate(0L) == nullptr && pool.allocate(priority::high, 0L) == nullptr);
+    for (int i = 0; i < 11; ++i) { pool.deallocate(objs.back()); objs.pop_back(); }
+    assert(pool.allocate(0L) == nullptr && pool.allocate(priority::high, 0L) != nullptr);
+}
+
+int main() {
+    rejects_and_admits_at_the_limits();
+    other_paths_obey_the_normal_limit();
+    clamps_the_fraction();
+    limit_below_live_count();
+    std::puts("test_priority_reserve ok");
+}
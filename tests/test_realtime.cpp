@@ -0,0 +1,74 @@
+// 实时模式：reserve + prefault + freeze / Real-time mode: reserve + prefault + freeze
+// g++ -std=c++20 -I. tests/test_realtime.cpp -o test_realtime && ./test_realtime
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#if !defined(_WIN32)
+  #include <sys/resource.h>
+#endif
+
+struct Msg {
+    long seq;
+    long payload[7];
+    explicit Msg(long s = 0) : seq(s) { for (long& x : payload) x = s; }
+};
+
+// prefault 不得改动存活对象 / prefault must leave live objects untouched
+static void prefault_keeps_live_objects() {
+    SegmentedObjectPool<Msg> pool;
+    std::vector<Msg*> v;
+    for (long i = 1; i <= 200; ++i) v.push_back(pool.allocate(i));
+    pool.prefault();
+    for (long i = 1; i <= 200; ++i) {
+        assert(v[i - 1]->seq == i);
+        for (long x : v[i - 1]->payload) assert(x == i);
+    }
+}
+
+#if !defined(_WIN32)
+static long minor_faults() {
+    rusage r;
+    getrusage(RUSAGE_SELF, &r);
+    return r.ru_minflt;
+}
+#endif
+
+// 冻结后的稳态分配回收不产生缺页 / Steady-state allocation after freeze takes no page faults
+static void no_page_faults_after_freeze() {
+    SegmentedObjectPool<Msg> pool;
+    assert(pool.reserve(100000) >= 100000);
+    pool.prefault();
+    int exhausted = 0;
+    pool.freeze([&] { ++exhausted; });
+
+    std::vector<Msg*> v;
+    v.reserve(100000);
+    for (long i = 0; i < 100000; ++i) v.push_back(pool.allocate(i));   // 预热 v 自身 / Warms v itself
+    for (Msg* p : v) pool.deallocate(p);
+    v.clear();
+
+#if !defined(_WIN32)
+    const long before = minor_faults();
+#endif
+    for (int round = 0; round < 20; ++round) {
+        for (long i = 0; i < 100000; ++i) v.push_back(pool.allocate(i));
+        for (Msg* p : v) pool.deallocate(p);
+        v.clear();
+    }
+#if !defined(_WIN32)
+    const long faults = minor_faults() - before;
+    std::printf("steady-state minor faults: %ld\n", faults);
+    assert(faults == 0);
+#endif
+
+    const std::size_t segments = pool.segments();
+    while (Msg* p = pool.allocate(0)) v.push_back(p);
+    assert(exhausted == 1 && pool.segments() == segments);
+    for (Msg* p : v) pool.deallocate(p);
+}
+
+int main() {
+    prefault_keeps_live_objects();
+    no_page_faults_after_freeze();
+    std::puts("test_realtime ok");
+}
@@ -0,0 +1,105 @@
+// 按键重排 / Key-ordered reordering
+// g++ -std=c++20 -I. tests/test_reorder.cpp -o test_reorder && ./test_reorder
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+
+// 带堆内存的成员，检查移动构造与析构成对出现 / A member owning heap memory checks moves and destructors pair up
+struct Position {
+    long id;
+    int instrument;
+    std::string note;
+};
+
+static std::vector<int> instruments_in_address_order(SegmentedObjectPool<Position>& pool, AllocHint set = {}) {
+    std::vector<int> keys;
+    pool.for_each(set, [&](Position& p) { keys.push_back(p.instrument); });
+    return keys;
+}
+
+// 完成后地址顺序与键顺序一致，搬迁回调维护的索引始终正确 / Address order follows key order, and the callback keeps an index exact
+static void sorts_by_key_across_segments() {
+    SegmentedObjectPool<Position> pool;
+    std::mt19937 rng(7);
+    std::vector<Position*> objs;
+    for (long i = 0; i < 20000; ++i)
+        objs.push_back(pool.allocate(Position{i, static_cast<int>(rng() % 500), "note " + std::to_string(i)}));
+    for (long i = 0; i < 20000; i += 7) pool.deallocate(objs[i]);   // 留下空洞 / Leave holes
+    std::map<long, Position*> index;
+    pool.for_each([&](Position& p) { index[p.id] = &p; });
+
+    std::size_t moves = 0;
+    auto job = pool.reorder([](const Position& p) { return p.instrument; },
+                            [&](Position*, Position* to) { index[to->id] = to; ++moves; });
+    assert(job.size() == pool.live() && !job.done());
+    std::size_t steps = 0;
+    while (!job.step(100)) ++steps;
+    assert(steps >= job.size() / 100 - 1 && moves > 0);
+
+    const std::vector<int> keys = instruments_in_address_order(pool);
+    assert(std::is_sorted(keys.begin(), keys.end()) && keys.size() == pool.live());
+    for (auto const& [id, p] : index) assert(p->id == id && p->note == "note " + std::to_string(id));
+}
+
+// 被移动的槽位代数加一，旧句柄失效；未移动的对象句柄仍然有效
+// Moved slots get a new generation so old handles lapse; objects that stayed put keep theirs
+static void moved_handles_lapse() {
+    SegmentedObjectPool<Position> pool;
+    std::vector<SlotHandle> hs;
+    for (long i = 0; i < 100; ++i) hs.push_back(pool.handle_of(pool.allocate(Position{i, i < 50 ? 0 : static_cast<int>(100 - i), ""})));
+    std::vector<bool> moved(100);
+    auto job = pool.reorder([](const Position& p) { return p.instrument; },
+                            [&](Position* from, Position*) { moved[pool.index_of(from) - hs[0].index] = true; });
+    job.step_for(std::chrono::seconds(1));
+    assert(job.done());
+    for (long i = 0; i < 100; ++i) {
+        Position* p = pool.resolve(hs[i]);
+        assert(moved[i] ? p == nullptr : p != nullptr && p->id == i);
+    }
+    assert(!moved[0]);   // 键为 0 的前 50 个对象已在原位 / The first 50 objects with key 0 were already in place
+}
+
+// 只重排指定段组，其他段组的对象不动 / Only the given set is reordered; objects elsewhere stay put
+static void only_the_given_set_moves() {
+    SegmentedObjectPool<Position> pool;
+    const AllocHint hot{3};
+    std::vector<Position*> other;
+    for (long i = 0; i < 1000; ++i) {
+        pool.allocate(hot, Position{i, static_cast<int>(1000 - i), ""});
+        other.push_back(pool.allocate(Position{i, static_cast<int>(1000 - i), ""}));
+    }
+    auto job = pool.reorder([](const Position& p) { return p.instrument; }, {}, hot);
+    assert(job.size() == 1000);
+    while (!job.step(64)) {}
+    const std::vector<int> keys = instruments_in_address_order(pool, hot);
+    assert(std::is_sorted(keys.begin(), keys.end()));
+    for (long i = 0; i < 1000; ++i) assert(other[i]->id == i);
+}
+
+// 变更标记跟着对象走 / Change marks follow the objects
+static void change_marks_follow_objects() {
+    SegmentedObjectPool<Position> pool;
+    pool.enable_change_tracking();
+    for (long i = 0; i < 300; ++i) pool.allocate(Position{i, static_cast<int>(300 - i), ""});
+    pool.for_each_dirty_and_clear([](Position&) {});
+    pool.for_each([&](Position& p) { if (p.id % 10 == 0) pool.mark_dirty(&p); });
+    {
+        auto job = pool.reorder([](const Position& p) { return p.instrument; });
+        while (!job.step(32)) {}
+    }
+    std::size_t marked = 0;
+    pool.for_each_dirty_and_clear([&](Position& p) { assert(p.id % 10 == 0); ++marked; });
+    assert(marked == 30);
+    pool.allocate(Position{-1, 0, ""});   // 任务结束后可再分配 / Allocation works again once the job is gone
+}
+
+int main() {
+    sorts_by_key_across_segments();
+    moved_handles_lapse();
+    only_the_given_set_moves();
+    change_marks_follow_objects();
+    std::puts("test_reorder ok");
+}
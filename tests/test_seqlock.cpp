@@ -0,0 +1,106 @@
+// 顺序锁读取 / Seqlock-protected reads
+// g++ -std=c++20 -I. tests/test_seqlock.cpp -o test_seqlock -lpthread && ./test_seqlock
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <thread>
+
+struct Quote { long bid, ask; };
+
+// 字段用 relaxed 原子访问，撕裂由序号发现而不是数据竞争 / Relaxed atomic field access, so tearing is caught by the sequence, not a data race
+static void store(Quote& q, long v) {
+    __atomic_store_n(&q.bid, v, __ATOMIC_RELAXED);
+    __atomic_store_n(&q.ask, v, __ATOMIC_RELAXED);
+}
+
+static Quote load(const Quote& q) {
+    return Quote{__atomic_load_n(&q.bid, __ATOMIC_RELAXED), __atomic_load_n(&q.ask, __ATOMIC_RELAXED)};
+}
+
+static void reads_current_value() {
+    SegmentedObjectPool<Quote> pool;
+    Quote* q = pool.allocate(Quote{1, 2});
+    assert(!pool.seq_ref(pool.handle_of(q)));        // 未开启时没有读端引用 / No reader reference before enable_seqlock
+    pool.enable_seqlock();
+    auto ref = pool.seq_ref(q);
+    Quote out{};
+    assert(ref && ref.read([&](const Quote& v) { out = v; }) && out.bid == 1 && out.ask == 2);
+    {
+        auto g = pool.write_guard(q);
+        q->bid = 3;
+        q->ask = 4;
+    }
+    assert(ref.read([&](const Quote& v) { out = v; }) && out.bid == 3 && out.ask == 4);
+
+    int foreign = 0;
+    { auto g = pool.write_guard(reinterpret_cast<const Quote*>(&foreign)); }   // 外来指针什么也不做 / Inert for foreign pointers
+}
+
+// 读取期间发生写入时重读 / A write during the read makes it retry
+static void retries_after_concurrent_write() {
+    SegmentedObjectPool<Quote> pool;
+    pool.enable_seqlock();
+    Quote* q = pool.allocate(Quote{1, 1});
+    auto ref = pool.seq_ref(q);
+    int calls = 0;
+    Quote out{};
+    assert(ref.read([&](const Quote& v) {
+        out = v;
+        if (++calls == 1) { auto g = pool.write_guard(q); *q = Quote{2, 2}; }
+    }));
+    assert(calls == 2 && out.bid == 2 && out.ask == 2);
+}
+
+// 对象回收后读取失败，槽位被复用也一样 / Reads fail once the object is recycled, even after the slot is reused
+static void fails_after_recycle() {
+    SegmentedObjectPool<Quote> pool;
+    pool.enable_seqlock();
+    Quote* q = pool.allocate(Quote{1, 1});
+    auto ref = pool.seq_ref(q);
+    pool.deallocate(q);
+    int calls = 0;
+    assert(!ref.read([&](const Quote&) { ++calls; }) && calls == 0);
+    Quote* again = pool.allocate(Quote{5, 5});
+    assert(again == q);
+    assert(!ref.read([&](const Quote&) { ++calls; }) && calls == 0);
+    assert(pool.seq_ref(again).read([&](const Quote& v) { assert(v.bid == 5); }));
+}
+
+// 写线程持续改写时读线程看不到撕裂的值 / Readers never see a torn value while a writer keeps rewriting
+static void no_torn_reads_under_contention() {
+    SegmentedObjectPool<Quote> pool;
+    pool.enable_seqlock();
+    Quote* q = pool.allocate(Quote{0, 0});
+    auto ref = pool.seq_ref(q);
+    std::atomic<bool> stop{false};
+    std::atomic<long> reads{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t)
+        readers.emplace_back([&] {
+            long last = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                Quote v{};
+                assert(ref.read([&](const Quote& x) { v = load(x); }));
+                assert(v.bid == v.ask && v.bid >= last);
+                last = v.bid;
+                ++reads;
+            }
+        });
+    for (long i = 1; i <= 200000; ++i) {
+        auto g = pool.write_guard(q);
+        store(*q, i);
+    }
+    while (reads < 1000) std::this_thread::yield();
+    stop = true;
+    for (auto& r : readers) r.join();
+    Quote v{};
+    assert(ref.read([&](const Quote& x) { v = load(x); }) && v.bid == 200000);
+}
+
+int main() {
+    reads_current_value();
+    retries_after_concurrent_write();
+    fails_after_recycle();
+    no_torn_reads_under_contention();
+    std::puts("test_seqlock ok");
+}
@@ -0,0 +1,99 @@
+// 信号处理函数中分配 / Allocating in signal handlers
+// g++ -std=c++20 -I. tests/test_signal_reserve.cpp -o test_signal_reserve -lpthread && ./test_signal_reserve
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <csignal>
+#include <cstdio>
+#include <set>
+#include <thread>
+
+struct CrashRecord : PooledObject<CrashRecord> {
+    int signo = 0;
+    long tag;
+    explicit CrashRecord(long t = 0) : tag(t) {}
+};
+
+// 取完即返回 nullptr，补满后可再取；取出的对象是普通的存活对象
+// Empty once drained and usable again after a refill; objects handed out are ordinary live objects
+static void drain_and_refill() {
+    SegmentedObjectPool<CrashRecord> pool;
+    assert(pool.signal_allocate() == nullptr);          // 没有保留时 / Without a reserve
+    assert(pool.reserve_for_signals(4, 42L) == 4 && pool.live() == 4);
+    std::set<CrashRecord*> taken;
+    for (int i = 0; i < 4; ++i) {
+        CrashRecord* r = pool.signal_allocate();
+        assert(r && r->tag == 42 && !pool.is_recycled(r));
+        taken.insert(r);
+    }
+    assert(taken.size() == 4 && pool.signal_allocate() == nullptr && pool.live() == 4);
+    for (CrashRecord* r : taken) pool.deallocate(r);
+    assert(pool.live() == 0);
+    assert(pool.refill_signal_reserve(7L) == 4 && pool.live() == 4);
+    assert(pool.signal_allocate()->tag == 7);
+    assert(pool.refill_signal_reserve(8L) == 4 && pool.live() == 5);   // 只补空位 / Only empty positions are refilled
+}
+
+static CrashRecord* volatile caught[3];
+static volatile std::sig_atomic_t hits = 0;
+
+static void on_signal(int sig) {
+    CrashRecord* r = CrashRecord::signal_create();
+    if (r) r->signo = sig;
+    caught[hits] = r;
+    hits = hits + 1;
+}
+
+// 在真正的信号处理函数里取对象 / Taking objects inside a real signal handler
+static void inside_a_handler() {
+    auto& pool = SegmentedObjectPool<CrashRecord>::instance();
+    pool.reserve_for_signals(2);
+    struct sigaction sa{};
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    assert(::sigaction(SIGUSR1, &sa, nullptr) == 0);
+    for (int i = 0; i < 3; ++i) std::raise(SIGUSR1);
+    ::signal(SIGUSR1, SIG_DFL);
+    assert(hits == 3);
+    assert(caught[0] && caught[1] && caught[0] != caught[1] && !caught[2]);
+    assert(caught[0]->signo == SIGUSR1 && caught[1]->signo == SIGUSR1);
+    caught[0]->recycle();
+    caught[1]->recycle();
+    assert(pool.refill_signal_reserve() == 2);
+}
+
+// 仍在栈上的保留对象在 collect 中视为根 / Reserve objects still on the stack count as roots in collect
+static void reserve_survives_collect() {
+    SegmentedObjectPool<CrashRecord> pool;
+    pool.reserve_for_signals(3);
+    for (int i = 0; i < 5; ++i) pool.allocate();
+    CrashRecord* taken = pool.signal_allocate();
+    assert(pool.collect() == 6);                  // 5 个普通对象加已取出的那个 / The 5 plain objects plus the one taken
+    assert(pool.live() == 2 && pool.is_recycled(taken));
+    assert(pool.signal_allocate() && pool.signal_allocate() && !pool.signal_allocate());
+}
+
+// 多个线程同时取用，每个对象只被取一次 / Threads popping at once each get distinct objects
+static void concurrent_pops_are_distinct() {
+    SegmentedObjectPool<CrashRecord> pool;
+    for (int round = 0; round < 20; ++round) {
+        if (round == 0) pool.reserve_for_signals(1000);
+        else assert(pool.refill_signal_reserve() == 1000);
+        std::vector<CrashRecord*> got[4];
+        std::vector<std::thread> ts;
+        for (auto& g : got)
+            ts.emplace_back([&pool, &g] { while (CrashRecord* r = pool.signal_allocate()) g.push_back(r); });
+        for (auto& t : ts) t.join();
+        std::set<CrashRecord*> all;
+        for (auto& g : got) all.insert(g.begin(), g.end());
+        assert(all.size() == 1000);
+        for (CrashRecord* r : all) pool.deallocate(r);
+    }
+}
+
+int main() {
+    drain_and_refill();
+    inside_a_handler();
+    reserve_survives_collect();
+    concurrent_pops_are_distinct();
+    std::puts("test_signal_reserve ok");
+}
@@ -0,0 +1,86 @@
+// 并发快照遍历 / Snapshot iteration alongside atomic_* calls
+// g++ -std=c++20 -I. tests/test_snapshot.cpp -o test_snapshot -lpthread && ./test_snapshot
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+#include <thread>
+
+struct Order { long id; long qty; };
+
+// 回调在锁内执行，可以直接用非 atomic 接口模拟批次之间的并发修改
+// The callback runs under the lock, so plain calls in it stand in for changes made between batches
+
+// 遍历中回收的对象被跳过，槽位被复用后的新对象不被访问 / Objects recycled mid-walk are skipped, and new objects in reused slots are not visited
+static void skips_recycled_and_new_objects() {
+    SegmentedObjectPool<Order> pool;
+    std::vector<Order*> objs;
+    for (long i = 0; i < 1000; ++i) objs.push_back(pool.allocate(Order{i, 1}));
+    std::vector<int> visits(1000);
+    pool.atomic_for_each_snapshot([&](Order& o) {
+        assert(o.id >= 0 && o.id < 1000);
+        ++visits[o.id];
+        if (o.id % 10 == 0 && o.id + 1 < 1000) {
+            pool.deallocate(objs[o.id + 1]);
+            Order* fresh = pool.allocate(Order{-1, 0});
+            assert(fresh == objs[o.id + 1]);   // 同一槽位，新代数 / Same slot, new generation
+        }
+    }, 1);
+    for (long i = 0; i < 1000; ++i) assert(visits[i] == (i % 10 == 1 ? 0 : 1));
+}
+
+// 遍历中被释放的段整段跳过 / A segment released mid-walk is skipped as a whole
+static void skips_released_segments() {
+    SegmentedObjectPool<Order> pool;
+    const AllocHint late = pool.create_group();
+    std::vector<Order*> early;
+    for (long i = 0; i < 100; ++i) early.push_back(pool.allocate(Order{i, 0}));
+    for (long i = 100; i < 200; ++i) pool.allocate(late, Order{i, 0});
+    long visited = 0;
+    bool released = false;
+    pool.atomic_for_each_snapshot([&](Order& o) {
+        ++visited;
+        if (!released) { released = true; assert(pool.release_group(late) == 100); }
+        assert(o.id < 100);
+    }, 16);
+    assert(released && visited == 100);
+}
+
+// 其他线程 atomic_* 分配回收的同时遍历：稳定对象各访问一次，临时对象至多一次
+// Walking while another thread allocates and recycles through atomic_*: stable objects are visited
+// once each, transient ones at most once
+static void concurrent_with_atomic_calls() {
+    SegmentedObjectPool<Order> pool;
+    for (long i = 0; i < 20000; ++i) pool.allocate(Order{i, 0});
+    std::atomic<bool> stop{false};
+    std::thread churn([&] {
+        std::vector<Order*> mine;
+        long next = 1000000;
+        while (!stop.load(std::memory_order_relaxed)) {
+            for (int k = 0; k < 64; ++k) mine.push_back(pool.atomic_allocate(Order{next++, 0}));
+            for (int k = 0; k < 48; ++k) { pool.atomic_deallocate(mine.back()); mine.pop_back(); }
+            std::this_thread::yield();
+        }
+        for (Order* o : mine) pool.atomic_deallocate(o);
+    });
+    for (int round = 0; round < 5; ++round) {
+        long stable = 0;
+        std::vector<long> transient;
+        pool.atomic_for_each_snapshot([&](Order& o) {
+            if (o.id < 20000) { assert(o.qty == round); ++o.qty; ++stable; }
+            else transient.push_back(o.id);
+        }, 64);
+        assert(stable == 20000);
+        std::sort(transient.begin(), transient.end());
+        assert(std::adjacent_find(transient.begin(), transient.end()) == transient.end());
+    }
+    stop = true;
+    churn.join();
+    assert(pool.live() == 20000);
+}
+
+int main() {
+    skips_recycled_and_new_objects();
+    skips_released_segments();
+    concurrent_with_atomic_calls();
+    std::puts("test_snapshot ok");
+}
@@ -0,0 +1,80 @@
+// 分层时间轮 / Hierarchical timing wheel
+// g++ -std=c++20 -I. tests/test_timer_wheel.cpp -o test_timer_wheel && ./test_timer_wheel
+#undef NDEBUG
+#include "SegmentedObjectPool.hpp"
+#include <cstdio>
+
+struct Session { long id; };
+
+// 层边界上的定时器在 advance(exp) 时触发，而不是 exp+1 / Timers on a level boundary fire at advance(exp), not exp+1
+static void fires_exactly_on_level_boundaries() {
+    for (std::uint64_t exp : {63u, 64u, 65u, 128u, 4095u, 4096u, 8192u, 262144u, 524288u}) {
+        SegmentedObjectPool<Session> pool;
+        PoolTimerWheel<Session> wheel(pool);
+        wheel.schedule(pool.allocate(Session{1}), exp);
+        assert(wheel.advance(exp - 1) == 0);
+        assert(wheel.advance(exp) == 1);
+        assert(pool.live() == 0 && wheel.pending() == 0);
+    }
+}
+
+// 逐刻度推进时每个定时器恰好在到期刻度触发 / Ticking one at a time, every timer fires at its own tick
+static void fires_on_time_when_ticking() {
+    SegmentedObjectPool<Session> pool;
+    PoolTimerWheel<Session> wheel(pool, 10);
+    std::vector<std::uint64_t> due;
+    for (std::uint64_t t = 11; t < 20000; t += 37) {
+        wheel.schedule(pool.allocate(Session{static_cast<long>(t)}), t);
+        due.push_back(t);
+    }
+    std::size_t next = 0;
+    for (std::uint64_t now = 11; now < 20000; ++now) {
+        std::uint64_t fired_at = 0;
+        const std::size_t n = wheel.advance(now, [&](Session& s) { fired_at = static_cast<std::uint64_t>(s.id); });
+        if (next < due.size() && due[next] == now) {
+            assert(n == 1 && fired_at == now);
+            ++next;
+        } else {
+            assert(n == 0);
+        }
+    }
+    assert(next == due.size());
+}
+
+// 提前回收的对象和取消的定时器不会触发 / Recycled objects and cancelled timers do not fire
+static void cancelled_and_recycled() {
+    SegmentedObjectPool<Session> pool;
+    PoolTimerWheel<Session> wheel(pool);
+    Session* a = pool.allocate(Session{1});
+    Session* b = pool.allocate(Session{2});
+    auto ta = wheel.schedule(a, 100);
+    wheel.schedule(b, 100);
+    assert(wheel.cancel(ta) && !wheel.cancel(ta));
+    pool.deallocate(b);
+    assert(wheel.advance(1000) == 0 && pool.live() == 1);
+}
+
+// 到期回收与 recycle() 一样调用 reset 并置回收标记 / Expiry runs reset and sets the recycled flag, like recycle()
+struct Conn : PooledObject<Conn> {
+    static inline int resets = 0;
+    long id;
+    explicit Conn(long i) : id(i) {}
+    void reset() override { ++resets; }
+};
+
+static void expiry_goes_through_recycle() {
+    auto& pool = SegmentedObjectPool<Conn>::instance();
+    PoolTimerWheel<Conn> wheel(pool);
+    Conn* c = Conn::create(1L);
+    wheel.schedule(c, 5);
+    assert(wheel.advance(5) == 1);
+    assert(Conn::resets == 1 && c->is_recycled());
+}
+
+int main() {
+    fires_exactly_on_level_boundaries();
+    fires_on_time_when_ticking();
+    cancelled_and_recycled();
+    expiry_goes_through_recycle();
+    std::puts("test_timer_wheel ok");
+}